@@ -0,0 +1,75 @@
+#include <zephyr/kernel.h>
+
+#ifndef FAULT_INJECT_H
+#define FAULT_INJECT_H
+
+// Faults that can be injected, and what detects them and recovers from them
+enum fault_inject_kind {
+    FAULT_INJECT_RTDB,          // an RTDB value is corrupted at a tick boundary: detected and repaired by job2
+    FAULT_INJECT_FRAME,         // a bit of a received frame is flipped: detected when the frame is rejected
+    FAULT_INJECT_EXEC,          // a job runs FAULT_INJECT_EXEC_US longer: detected by the scheduler (overrun,
+                                // late or missed tick), recovered at the first tick after it on time
+    FAULT_INJECT_DELAY,         // the releases of a tick are delayed by FAULT_INJECT_DELAY_US: same as EXEC
+    FAULT_INJECT_NUM_KINDS
+};
+
+// Injection rates, in per-mille of the opportunities (ticks, frames or jobs), 0 to disable.
+// Set at build time (e.g. -DFAULT_INJECT_RTDB_RATE=100) or at run time over UART (frame X),
+// with CONFIG_STBS_FAULT_INJECT enabled
+#ifndef FAULT_INJECT_RTDB_RATE
+#define FAULT_INJECT_RTDB_RATE 0
+#endif
+#ifndef FAULT_INJECT_FRAME_RATE
+#define FAULT_INJECT_FRAME_RATE 0
+#endif
+#ifndef FAULT_INJECT_EXEC_RATE
+#define FAULT_INJECT_EXEC_RATE 0
+#endif
+#ifndef FAULT_INJECT_DELAY_RATE
+#define FAULT_INJECT_DELAY_RATE 0
+#endif
+
+// Size of the timing faults: longer than a tick of the application, so they cannot be absorbed
+#ifndef FAULT_INJECT_EXEC_US
+#define FAULT_INJECT_EXEC_US 60000
+#endif
+#ifndef FAULT_INJECT_DELAY_US
+#define FAULT_INJECT_DELAY_US 60000
+#endif
+
+#define FAULT_INJECT_TIMEOUT_TICKS 20   // an injection not detected within these ticks was masked
+#define FAULT_INJECT_SEED 0xFA17        // same faults on every run with the same rates
+
+// Outcome of the injections of a kind, since boot or the last reset
+typedef struct {
+    uint32_t injected;
+    uint32_t detected;
+    uint32_t masked;                // not detected within FAULT_INJECT_TIMEOUT_TICKS (or accepted, for frames)
+    uint32_t recovered;
+    uint32_t max_detection_ticks;   // tick boundaries from the injection to its detection
+    uint32_t max_recovery_ticks;    // tick boundaries from the injection to the recovery
+} fault_inject_stats;
+
+#ifdef CONFIG_STBS_FAULT_INJECT
+// Function prototypes
+int fault_inject_set_rate(int kind, int rate);
+int fault_inject_get_rate(int kind);
+void fault_inject_tick(void);
+int fault_inject_frame(char *frame, int length);
+void fault_inject_frame_checked(int rejected);
+void fault_inject_exec(void);
+void fault_inject_detected(int kind);
+void fault_inject_timing_fault(void);
+int fault_inject_get_stats(int kind, fault_inject_stats *stats);
+void fault_inject_reset_stats(void);
+#else
+// Without fault injection the hooks of the tasks, the tick and the frames do nothing
+static inline void fault_inject_tick(void) {}
+static inline int fault_inject_frame(char *frame, int length) { return 0; }
+static inline void fault_inject_frame_checked(int rejected) {}
+static inline void fault_inject_exec(void) {}
+static inline void fault_inject_detected(int kind) {}
+static inline void fault_inject_timing_fault(void) {}
+#endif
+
+#endif // FAULT_INJECT_H
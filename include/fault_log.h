@@ -0,0 +1,48 @@
+#include <zephyr/kernel.h>
+
+#ifndef FAULT_LOG_H
+#define FAULT_LOG_H
+
+// Events kept in the fault log
+enum fault_log_event {
+    FAULT_LOG_OVERRUN,          // source: task index, value: overruns of the task so far
+    FAULT_LOG_NOT_SCHEDULABLE,  // value: error of the table build
+    FAULT_LOG_CORRUPTED,        // source: RTDB field (enum rtdb_field), value: the corrupted value
+    FAULT_LOG_DROPPED,          // value: events lost because the queue was full
+    FAULT_LOG_LATE_RELEASE,     // value: release latency of the tick in us
+    FAULT_LOG_MISSED_TICK,      // value: ticks skipped
+    FAULT_LOG_NUM_EVENTS
+};
+
+// One event, as it is stored in flash (12 bytes)
+typedef struct {
+    uint32_t uptime_ms;         // since the boot that recorded it
+    uint16_t boot;              // one more than the boot of the newest event in the log when it started
+                                // (boots without events are not counted)
+    uint8_t event;              // enum fault_log_event
+    uint8_t source;
+    int32_t value;
+} fault_log_entry;
+
+#define FAULT_LOG_QUEUE_SIZE 32     // events waiting to be written, the ones after are dropped (and counted)
+#define FAULT_LOG_BATCH_SIZE 16     // events written together in one flash entry
+#define FAULT_LOG_BATCH_MS 1000     // longest time an event waits in the queue before it is written
+#define FAULT_LOG_MAX_SECTORS 32    // flash sectors of the log partition
+#define FAULT_LOG_RAM_SIZE 32       // newest events kept in RAM when the board has no log partition
+
+// Writer thread: below the application threads, it only takes the idle time
+#ifndef FAULT_LOG_PRIORITY
+#define FAULT_LOG_PRIORITY K_LOWEST_APPLICATION_THREAD_PRIO
+#endif
+#define FAULT_LOG_STACK_SIZE 1024
+
+extern const k_tid_t fault_log_writer;
+
+// Function prototypes
+int fault_log_init(void);
+void fault_log_record(int event, int source, int value);
+int fault_log_flush(void);
+int fault_log_read(fault_log_entry *entries, int max, uint32_t *total);
+int fault_log_clear(void);
+
+#endif // FAULT_LOG_H
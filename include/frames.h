@@ -2,14 +2,20 @@
 #define FRAMES_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 // Function prototypes
 void process_frames(const char *frame, int frame_length, int checksum);
 int calculate_checksum(const char *frame, int length);
 void send_ack(char error_code);
 void set_led(int led_index, int value);
+void set_leds(uint8_t states);
 bool validate_led_states(const char *payload);
 void send_inputs();
 void send_outputs();
+void send_latency(int probe);
+void send_stats(bool reset);
+void send_faults(void);
+void send_fault_injection(void);
 
 #endif // FRAMES_H
@@ -8,14 +8,22 @@
 
 
 
+// Job run to completion by the dispatcher, instead of a thread released every period
+typedef void (*STBS_job)(void *arg);
+
 typedef struct {
-    k_tid_t id;                      // Unique identifier for the task
-    int ticks;                   // Task's period in ticks (relative to the scheduler's tick)
-    int next_activation;         // Tick count for the next activation of the task
+    k_tid_t id;                      // Unique identifier for the task (see STBS_JOB_ID for jobs)
+    int ticks;                   // Task's period in ticks (relative to the tick of its rate group)
+    int next_activation;         // Tick of the next release of the task in the macro-cycle (set while the table is filled)
     int priority;                // Priority level of the thread (lower values = higher priority in Zephyr)
-    int exec_time;              // execution time in ms
+    int exec_time;              // execution time in microseconds
     int to_be_executed;         // flag that says if the task was supposed to be executed in a previous tick, but it didnt have enough time left
     int delay_count;            // CHANGED! It counts the number of times a task was put to execute in the next clock cycle
+    int cpu;                    // CPU the task is assigned to (partitioned multi-core scheduling)
+    int group;                  // rate group of the task (its period is in ticks of the group)
+    STBS_job job;               // job function, or NULL if the task is a thread
+    void *job_arg;              // argument of the job function
+    int max_jitter;             // maximum start-time jitter in us, or -1 if not constrained
     char *name;
 } Task;
 
@@ -0,0 +1,30 @@
+#include <zephyr/kernel.h>
+
+#ifndef IO_H
+#define IO_H
+
+#define IO_NUM_LEDS 4
+#define IO_NUM_BUTTONS 4
+#define IO_MAX_PORTS (IO_NUM_LEDS + IO_NUM_BUTTONS)
+
+#define IO_DEBOUNCE_US 20000        // Default button debounce window in microseconds
+#define IO_EVENT_QUEUE_LEN 16       // Number of button edges that can be queued
+
+// Debounced button edge, captured by the GPIO interrupt
+typedef struct {
+    uint32_t timestamp;     // cycle counter (k_cycle_get_32) at the edge
+    uint8_t button;         // button index
+    uint8_t level;          // logical level after the edge (1 = pressed)
+} button_event;
+
+// Function prototypes
+int io_init(void);
+int io_write_leds(uint8_t led_mask);
+uint8_t io_read_buttons(void);
+int io_buttons_irq_init(uint32_t debounce_us);
+void io_set_debounce_us(uint32_t debounce_us);
+int io_get_button_event(button_event *evt);
+int io_get_button_event_until(button_event *evt, uint32_t cutoff);
+uint32_t io_get_dropped_events(void);
+
+#endif // IO_H
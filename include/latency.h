@@ -0,0 +1,36 @@
+#include <zephyr/kernel.h>
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+// Paths whose end-to-end latency is measured
+enum latency_probe {
+    LATENCY_BUTTON_TO_LED,      // button edge (GPIO interrupt) to the LED write
+    LATENCY_FRAME_TO_ACK,       // first byte of a frame to its ACK handed to the UART
+    LATENCY_FAULT_DETECTION,    // injected fault to its detection (see fault_inject.h)
+    LATENCY_FAULT_RECOVERY,     // injected fault to the recovery of the system
+    LATENCY_NUM_PROBES
+};
+
+// Histogram buckets: 4 per power of two, so a percentile is within 25% of the real value
+#define LATENCY_SUB_BUCKETS_LOG2 2
+#define LATENCY_MAX_US ((1u << 26) - 1)     // longer latencies are counted as this value (67 s)
+#define LATENCY_NUM_BUCKETS 100
+
+// Summary of the latencies recorded by a probe, in microseconds
+typedef struct {
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t p50_us;
+    uint32_t p90_us;
+    uint32_t p99_us;
+    uint32_t max_us;
+} latency_summary;
+
+// Function prototypes
+void latency_record(int probe, uint32_t start_cycles);
+void latency_record_us(int probe, uint32_t us);
+int latency_get_summary(int probe, latency_summary *summary);
+int latency_reset(int probe);
+
+#endif // LATENCY_H
@@ -1,6 +1,8 @@
 #ifndef RTDB_H
 #define RTDB_H
 
+#include <stdint.h>
+
 // realtime database
 
 
@@ -19,10 +21,30 @@ typedef struct {
 
 } RT_db;
 
+// Fields of the database, to access them by index (see RT_db_field())
+enum rtdb_field {
+    RTDB_LED0, RTDB_LED1, RTDB_LED2, RTDB_LED3,
+    RTDB_BUTTON0, RTDB_BUTTON1, RTDB_BUTTON2, RTDB_BUTTON3,
+    RTDB_NUM_FIELDS
+};
+
 
 // Function to initialize the database
 void RT_db_init(RT_db *db);
 int RT_db_update(RT_db *db, char* command);
 void RT_db_print(RT_db *db);
+uint8_t RT_db_get_leds(RT_db *db);
+void RT_db_set_buttons(RT_db *db, uint8_t button_mask);
+void RT_db_set_button(RT_db *db, int button_index, int value);
+void RT_db_toggle_led(RT_db *db, int led_index);
+int *RT_db_field(RT_db *db, int field);
+
+// Logical-execution-time (LET) double buffering
+void RT_db_let_init(RT_db *db, int enable);
+int RT_db_let_enabled(void);
+RT_db *RT_db_in(void);
+RT_db *RT_db_out(void);
+RT_db *RT_db_let_swap(void);
+void RT_db_let_latch_button(int button_index, int value);
 
 #endif // RTDB_H
\ No newline at end of file
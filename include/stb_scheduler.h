@@ -5,13 +5,26 @@
 #define STB_SCHEDULER_H
 
 
+// Rate groups: each has its own tick, tasks and table. Group 0 is the fastest one, and every
+// other group runs in the time left by the faster groups
+#ifndef STBS_MAX_GROUPS
+#define STBS_MAX_GROUPS 2
+#endif
+
+typedef struct {
+    int tick_us;                 // tick duration of the group in microseconds
+    int macro_cycle;             // macrocycle of the group table (in ticks of the group)
+} STBS_rate_group;
+
 // Scheduler structure to manage tasks and execution
 typedef struct {
-    int tick_ms;                 // Scheduler tick duration in milliseconds
+    STBS_rate_group groups[STBS_MAX_GROUPS];    // group 0 has the tick given to STBS_Init()
+    int num_groups;              // Current number of rate groups
     Task *task_table;  // Array of tasks
     int max_tasks;               // Maximum number of tasks allowed
     int num_tasks;               // Current number of tasks
-    int macro_cycle;              // Macrocycle duration (in ticks)
+    int num_cpus;                // CPUs the tasks are partitioned on (one table and dispatcher each)
+    int window;                  // ticks of each table kept in memory (streaming), or 0 for the whole macrocycle
 } STB_scheduler;
 
 typedef struct{
@@ -22,16 +35,166 @@ typedef struct{
 }scheduler_table_entry;
 
 
-void STBS_Init(int tick_ms, int max_tasks);
+// Partitioned multi-core scheduling needs to pin the threads to the CPUs
+#if defined(CONFIG_SMP) && defined(CONFIG_SCHED_CPU_MASK)
+#define STBS_MAX_CPUS CONFIG_MP_MAX_NUM_CPUS
+#else
+#define STBS_MAX_CPUS 1
+#endif
+
+// Dispatcher threads: cooperative, above all the scheduled tasks
+#define STBS_DISPATCHER_PRIORITY K_HIGHEST_APPLICATION_THREAD_PRIO
+#define STBS_DISPATCHER_STACK_SIZE 1536     // also runs the jobs
+#define STBS_START_DELAY_MS 20      // time given to the tasks to suspend themselves before the first tick
+
+
+// Dispatcher overheads, counted on top of the execution times of the tasks (see STBS_Calibrate)
+typedef struct {
+    int tick_us;                // per tick: waking up the dispatcher, statistics, and switching out when it waits
+    int release_us;             // per task released: resuming it and switching into and out of it
+} STBS_overhead;
+
+#define STBS_CALIBRATION_RUNS 32    // round trips measured, the longest is kept
+
+// Identifier of a job, to pass it to the functions that take a task identifier
+#define STBS_JOB_ID(job) ((k_tid_t)(job))
+
+// Scheduled tasks: all at the same preemptive priority, so the tasks of a tick run in table order
+#define STBS_TASK_PRIORITY 5
+
+// Slower rate groups: their tasks run below the tasks of the faster groups, and their
+// (preemptive) dispatcher just above their tasks
+#define STBS_GROUP_TASK_PRIORITY(group) (STBS_TASK_PRIORITY + 2 * (group))
+#define STBS_GROUP_DISPATCHER_PRIORITY(group) \
+    ((group) == 0 ? STBS_DISPATCHER_PRIORITY : STBS_GROUP_TASK_PRIORITY(group) - 1)
+
+// Window filler thread (streaming tables, see STBS_SetWindow): below all the scheduled tasks
+#define STBS_FILLER_PRIORITY (STBS_GROUP_TASK_PRIORITY(STBS_MAX_GROUPS - 1) + 1)
+#define STBS_FILLER_STACK_SIZE 1024
+
+// Background lane (see STBS_AddBackground): tasks outside the table, below the scheduled tasks and
+// the filler, so they only run in the time the tables leave idle. Level 0 is the highest
+#define STBS_MAX_BACKGROUND 8
+#define STBS_BACKGROUND_LEVELS 4
+#define STBS_BACKGROUND_PRIORITY(level) (STBS_FILLER_PRIORITY + 1 + (level))
+
+#define STBS_MAX_PRECEDENCES 16
+
+// Precedence edge: the consumer reads the output of the producer
+typedef struct {
+    k_tid_t producer;
+    k_tid_t consumer;
+    int max_lag;                // ticks allowed from the producer job to the consumer job that reads its output
+} STBS_precedence;
+
+// Maximum size of the scheduler table, checked before building it
+#ifdef CONFIG_HEAP_MEM_POOL_SIZE
+#define STBS_MAX_TABLE_BYTES CONFIG_HEAP_MEM_POOL_SIZE
+#else
+#define STBS_MAX_TABLE_BYTES 4096
+#endif
+
+// Result of the analytical schedulability check (STBS_Check)
+typedef struct {
+    int utilization;            // total utilization of the busiest CPU (all the groups), in per-mille
+    int max_tick_demand;        // demand of the busiest tick (all tasks released together) of the busiest CPU and group, in us
+    int64_t hyperperiod;        // projected macro-cycle of the longest group table, in ticks of its group
+    int64_t table_bytes;        // projected size of the tables of all the groups, in bytes
+    int sufficient;             // 1 if every tick fits all the tasks of its CPU and group (schedulable without building)
+    int failed_task;            // index (in STBS_GetTaskTable()) of the first task that fails a condition, or -1
+    int failed_cpu;             // CPU it was checked on, or -1 if the failure does not depend on the CPU
+} STBS_check_report;
+
+// Run-time statistics of a task, since the scheduler started or the last STBS_ResetStats()
+typedef struct {
+    uint32_t activations;       // jobs released
+    uint32_t deferrals;         // jobs released after the tick of their period (deferred by the table)
+    uint32_t overruns;          // releases that found the previous job still running
+    uint32_t max_response_us;   // longest time from a release to the end of the job (STBS_WaitRelease)
+} STBS_task_stats;
+
+// Run-time statistics of the scheduler, since it started or the last STBS_ResetStats()
+typedef struct {
+    uint32_t ticks;                     // ticks dispatched (by CPU 0)
+    uint32_t load;                      // CPU load in per-mille (measured with CONFIG_SCHED_THREAD_USAGE_ALL, planned otherwise)
+    uint32_t min_slack_us;              // shortest time left in a tick after its last job ended
+    uint32_t max_release_latency_us;    // longest time from the tick timer expiry to the dispatcher release
+    uint32_t release_jitter_us;         // spread between the shortest and the longest release latency
+    uint32_t window_refills;            // ticks the dispatcher had to fill itself (streaming tables, filler late)
+    uint32_t late_releases;             // ticks released more than STBS_LATE_RELEASE_US after the timer expiry
+    uint32_t missed_ticks;              // ticks skipped because their dispatcher was still busy (all the groups and CPUs)
+    uint32_t background_load;           // CPU time of the background tasks in per-mille of all the CPUs (needs CONFIG_SCHED_THREAD_USAGE_ALL)
+} STBS_stats;
+
+// Function called by the dispatcher at the start of every tick, before releasing its tasks
+typedef void (*STBS_tick_hook)(int tick);
+
+// Faults reported to the fault hook
+enum stbs_fault {
+    STBS_FAULT_OVERRUN,             // a release found the previous job of the task still running (value: overruns so far)
+    STBS_FAULT_NOT_SCHEDULABLE,     // the table was not built (task -1, value: the error)
+    STBS_FAULT_LATE_RELEASE,        // a tick of group 0 was released more than STBS_LATE_RELEASE_US late (value: latency in us)
+    STBS_FAULT_MISSED_TICK,         // a dispatcher was still busy when its next ticks expired (value: ticks skipped)
+};
+
+// Release latency above which a tick is reported as late
+#ifndef STBS_LATE_RELEASE_US
+#define STBS_LATE_RELEASE_US 1000
+#endif
+
+// Function called when a fault is detected, from the dispatchers too: it must not block
+typedef void (*STBS_fault_hook)(int fault, int task, int value);
+
+void STBS_Init(int tick_us, int max_tasks);
+int STBS_SetNumCpus(int num_cpus);
+void STBS_SetTickHook(STBS_tick_hook hook);
+void STBS_SetFaultHook(STBS_fault_hook hook);
+int STBS_Calibrate(void);
+int STBS_SetOverhead(const STBS_overhead *overhead);
+void STBS_GetOverhead(STBS_overhead *overhead);
 void STBS_AddTask(int ticks, k_tid_t task_id, int priority, int execution_time, char *name);
+void STBS_AddJob(int ticks, STBS_job job, void *arg, int priority, int execution_time, char *name);
+int STBS_AddGroup(int tick_us);
+int STBS_SetGroup(k_tid_t task, int group);
+int STBS_SetWindow(int ticks);
+int STBS_AddPrecedence(k_tid_t producer, k_tid_t consumer, int max_lag);
+int STBS_SetMaxJitter(k_tid_t task, int max_jitter);
+int STBS_AddBackground(k_tid_t task_id, int level, char *name);
+int STBS_SetBackgroundDeadline(int deadline_us);
 void STBS_print_content();
-void STBS_Start();
+void STBS_print_slack();
+void STBS_print_overhead();
+void STBS_print_background();
+void STBS_print_precedences();
+void STBS_print_jitter();
+int STBS_Check(STBS_check_report *report);
+int STBS_BuildTable(void);
+int STBS_Start();
+int STBS_Stop();
+void STBS_WaitRelease(void);
+int STBS_GetTaskStats(int task, STBS_task_stats *stats);
+int STBS_GetStats(STBS_stats *stats);
+void STBS_ResetStats(void);
+void STBS_destroy();
 
 // for testing
 int STBS_GetNumTasks(void);
-int STBS_GetTickMs(void);
+int STBS_GetTickUs(void);
 const Task* STBS_GetTaskTable(void);
 int STBS_GetMacroCycle(void);
+int STBS_GetTableBytes(void);
+int STBS_GetTickSlack(int cpu, int tick);
+int STBS_GetNumCpus(void);
+int STBS_GetNumGroups(void);
+int STBS_GetGroupTickUs(int group);
+int STBS_GetGroupMacroCycle(int group);
+int STBS_GetGroupCapacity(int group, int cpu);
+int STBS_GetGroupTickSlack(int group, int cpu, int tick);
+int STBS_GetTickTasks(int group, int cpu, uint32_t seq, Task *tasks, int max);
+int STBS_GetPrecedenceLag(int edge);
+int STBS_GetChainLatency(const k_tid_t *chain, int length);
+int STBS_GetJitter(k_tid_t task);
+int STBS_GetBackgroundBudget(void);
 
 
 #endif
\ No newline at end of file
@@ -0,0 +1,184 @@
+#!/usr/bin/env python3
+"""Host-side frame driver for the STBS protocol.
+
+Sends protocol frames to the device over a serial port or over the
+pseudo-terminal of the native_sim build, and prints the replies.
+
+    west build -b native_sim && ./build/zephyr/zephyr.exe
+    # "uart connected to pseudotty: /dev/pts/N"
+    python3 scripts/stbs_host.py /dev/pts/N O11 O20 A1010 I E
+    python3 scripts/stbs_host.py /dev/pts/N L0 L1 R     # latency histograms, then reset
+    python3 scripts/stbs_host.py /dev/pts/N S SR        # scheduler statistics (SR also resets them)
+    python3 scripts/stbs_host.py /dev/pts/N F FC        # fault log, then clear it
+    python3 scripts/stbs_host.py /dev/pts/N XR0100 X    # inject RTDB corruptions (100 per-mille), then the outcome
+    python3 scripts/stbs_host.py /dev/pts/N XR0000 XZ   # stop injecting them, reset the outcome
+
+The X frames need a build with fault injection (-DCONFIG_STBS_FAULT_INJECT=y).
+
+Each argument is a command letter followed by its payload; the checksum
+and delimiters are added here. Only the standard library is used.
+"""
+
+import argparse
+import os
+import select
+import sys
+import termios
+import time
+import tty
+
+DEVICE_ID = "P"
+LATENCY_PROBES = ("button->LED", "frame->ACK", "fault->detection", "fault->recovery")
+LATENCY_FIELDS = ("count", "min", "p50", "p90", "p99", "max")
+FAULT_EVENTS = ("overrun", "not schedulable", "corrupted", "dropped", "late release", "missed tick")
+INJECT_KINDS = ("RTDB corruption", "frame bit flip", "execution overrun", "release delay")
+INJECT_FIELDS = ("injected", "detected", "masked", "recovered")
+RTDB_FIELDS = ("led0", "led1", "led2", "led3", "button0", "button1", "button2", "button3")
+
+
+def checksum(body):
+    """Sum of the frame bytes after '!' (mod 1000), as in calculate_checksum()."""
+    return sum(body.encode()) % 1000
+
+
+def build_frame(command, payload=""):
+    body = DEVICE_ID + command + payload
+    return "!%s%03d#" % (body, checksum(body))
+
+
+def parse_stats(reply):
+    """Decodes the scheduler statistics frame (!Ms...#) into a dict."""
+    hexa = lambda start, width: int(reply[start:start + width], 16)
+    stats = {"load": hexa(5, 4) / 10.0, "min_slack_us": hexa(9, 8),
+             "max_release_latency_us": hexa(17, 8), "release_jitter_us": hexa(25, 8), "tasks": []}
+    for i in range(hexa(3, 2)):
+        start = 33 + 32 * i
+        stats["tasks"].append(dict(zip(("activations", "deferrals", "overruns", "max_response_us"),
+                                       (hexa(start + 8 * j, 8) for j in range(4)))))
+    start = 33 + 32 * hexa(3, 2)
+    stats["tick_slack_us"] = [hexa(start + 2 + 8 * i, 8) for i in range(hexa(start, 2))]
+    return stats
+
+
+def parse_faults(reply):
+    """Decodes the fault log frame (!Mf...#) into the number of events logged and the newest ones."""
+    hexa = lambda start, width: int(reply[start:start + width], 16)
+    events = []
+    for i in range(hexa(11, 2)):
+        start = 13 + 24 * i
+        value = hexa(start + 16, 8)
+        events.append({"uptime_ms": hexa(start, 8), "boot": hexa(start + 8, 4), "event": hexa(start + 12, 2),
+                       "source": hexa(start + 14, 2), "value": value - (1 << 32) if value >= 1 << 31 else value})
+    return hexa(3, 8), events
+
+
+def parse_injection(reply):
+    """Decodes the fault injection frame (!Mx...#) into the rate and outcome of each fault kind."""
+    hexa = lambda start, width: int(reply[start:start + width], 16)
+    kinds = []
+    for start in range(3, len(reply) - 4 - 43, 44):
+        kind = {"rate": hexa(start, 4), "max_detection_ticks": hexa(start + 36, 4),
+                "max_recovery_ticks": hexa(start + 40, 4)}
+        kind.update((field, hexa(start + 4 + 8 * j, 8)) for j, field in enumerate(INJECT_FIELDS))
+        kinds.append(kind)
+    return kinds
+
+
+def describe_fault(event):
+    name = FAULT_EVENTS[event["event"]] if event["event"] < len(FAULT_EVENTS) else "event %d" % event["event"]
+    if event["event"] == 2 and event["source"] < len(RTDB_FIELDS):
+        source = RTDB_FIELDS[event["source"]]
+    else:
+        source = "task %d" % event["source"] if event["event"] == 0 else ""
+    return "  boot %d at %d ms: %s %s value %d" % (event["boot"], event["uptime_ms"], name, source, event["value"])
+
+
+def describe(reply):
+    """Decodes the latency summary, statistics, fault log and fault injection frames; other replies are returned as they are."""
+    if reply.startswith("!Ms"):
+        stats = parse_stats(reply)
+        lines = ["load %.1f%%, min slack %d us, release latency <= %d us, jitter %d us" % (
+            stats["load"], stats["min_slack_us"], stats["max_release_latency_us"], stats["release_jitter_us"])]
+        for i, task in enumerate(stats["tasks"]):
+            lines.append("  task %d: %d activations, %d deferrals, %d overruns, max response %d us" % (
+                i, task["activations"], task["deferrals"], task["overruns"], task["max_response_us"]))
+        if stats["tick_slack_us"]:
+            lines.append("  tick slack (us): " + " ".join("%d" % slack for slack in stats["tick_slack_us"]))
+        return "\n".join(lines)
+    if reply.startswith("!Mf"):
+        total, events = parse_faults(reply)
+        return "\n".join(["%d events logged, newest %d:" % (total, len(events))] + [describe_fault(e) for e in events])
+    if reply.startswith("!Mx"):
+        lines = []
+        for i, kind in enumerate(parse_injection(reply)):
+            name = INJECT_KINDS[i] if i < len(INJECT_KINDS) else "kind %d" % i
+            lines.append("  %s (%d per-mille): %s, detection <= %d ticks, recovery <= %d ticks" % (
+                name, kind["rate"], ", ".join("%d %s" % (kind[field], field) for field in INJECT_FIELDS),
+                kind["max_detection_ticks"], kind["max_recovery_ticks"]))
+        return "\n".join(["fault injection:"] + lines)
+    if not reply.startswith("!Ml") or len(reply) != 44:
+        return reply
+    values = [int(reply[4 + 6 * i:10 + 6 * i]) for i in range(len(LATENCY_FIELDS))]
+    probe = int(reply[3])
+    name = LATENCY_PROBES[probe] if probe < len(LATENCY_PROBES) else "probe %d" % probe
+    return "%s: %s" % (name, ", ".join(
+        "%s %d" % (field, value) if field == "count" else "%s %d us" % (field, value)
+        for field, value in zip(LATENCY_FIELDS, values)))
+
+
+def open_port(path):
+    fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+    tty.setraw(fd)
+    attrs = termios.tcgetattr(fd)
+    attrs[4] = attrs[5] = termios.B115200
+    termios.tcsetattr(fd, termios.TCSANOW, attrs)
+    return fd
+
+
+class FrameReader:
+    """Extracts '!...#' frames from a byte stream that also carries printk output."""
+
+    def __init__(self, fd):
+        self.fd = fd
+        self.pending = ""
+
+    def read(self, timeout):
+        deadline = time.monotonic() + timeout
+        while True:
+            start = self.pending.find("!M")
+            if start >= 0:
+                end = self.pending.find("#", start)
+                if end >= 0:
+                    frame = self.pending[start:end + 1]
+                    self.pending = self.pending[end + 1:]
+                    return frame
+            remaining = deadline - time.monotonic()
+            if remaining <= 0:
+                return None
+            ready, _, _ = select.select([self.fd], [], [], remaining)
+            if ready:
+                self.pending += os.read(self.fd, 256).decode(errors="replace")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("port", help="serial port or native_sim pseudo-terminal")
+    parser.add_argument("frames", nargs="+", help="command letter + payload, e.g. O11, A1010, I, E, L0, F, X")
+    parser.add_argument("--timeout", type=float, default=0.5, help="reply timeout in seconds")
+    parser.add_argument("--interval", type=float, default=0.1, help="time between frames in seconds")
+    args = parser.parse_args()
+
+    fd = open_port(args.port)
+    reader = FrameReader(fd)
+    for spec in args.frames:
+        frame = build_frame(spec[0], spec[1:])
+        os.write(fd, frame.encode())
+        reply = reader.read(args.timeout)
+        print("%-12s -> %s" % (frame, describe(reply) if reply else "(no reply)"))
+        time.sleep(args.interval)
+    os.close(fd)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
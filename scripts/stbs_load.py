@@ -0,0 +1,220 @@
+#!/usr/bin/env python3
+"""Host-side load generator and throughput benchmark for the STBS protocol.
+
+Sends a mix of O/A/I/E frames, some of them corrupted, at rising rates over
+a serial port or the pseudo-terminal of the native_sim build. For every rate
+it reports the sustained throughput, the frames lost or mis-ACKed, the ACK
+latency percentiles, the error codes received, and the release jitter of the
+table tasks while loaded (from the scheduler statistics frame).
+
+    west build -b native_sim && ./build/zephyr/zephyr.exe
+    # "uart connected to pseudotty: /dev/pts/N"
+    python3 scripts/stbs_load.py /dev/pts/N
+    python3 scripts/stbs_load.py /dev/pts/N --rates 20,50,100,200 --duration 10
+    python3 scripts/stbs_load.py /dev/pts/N --mix O=1,I=1 --corrupt 0.2
+
+The device answers the frames one by one in the order they arrive, so each
+reply is matched to the oldest frame still waiting for one: the frames
+skipped by a reply of another kind (an input frame for an ACK, ...) and the
+ones without a reply by the end of the step are counted as lost. A corrupted
+frame is expected to be answered with the error ACK of its corruption; any
+other ACK is a mis-ACK. Only the standard library is used.
+"""
+
+import argparse
+import os
+import random
+import sys
+import time
+
+from stbs_host import FrameReader, build_frame, checksum, open_port, parse_stats
+
+FRAME_KINDS = "OAIE"
+# error ACK expected for each corruption of a frame
+CORRUPTIONS = {"command": "2", "checksum": "3", "payload": "4"}
+ACK_CODES = {"1": "ok", "2": "unknown command", "3": "checksum", "4": "invalid payload"}
+DEFAULT_RATES = "10,20,50,100,200,500"
+DEFAULT_MIX = "O=4,A=2,I=2,E=2"
+
+
+def parse_mix(spec):
+    """Parses "O=4,A=2,..." into the frame kinds and their weights."""
+    mix = {}
+    for item in spec.split(","):
+        kind, _, weight = item.partition("=")
+        if kind not in FRAME_KINDS or not weight.isdigit():
+            raise argparse.ArgumentTypeError("invalid mix item %r, expected e.g. O=4" % item)
+        mix[kind] = int(weight)
+    if sum(mix.values()) == 0:
+        raise argparse.ArgumentTypeError("the mix sends no frame")
+    return mix
+
+
+def parse_rates(spec):
+    try:
+        rates = [float(rate) for rate in spec.split(",")]
+    except ValueError:
+        raise argparse.ArgumentTypeError("invalid rates %r, expected e.g. 10,20,50" % spec)
+    if any(rate <= 0 for rate in rates):
+        raise argparse.ArgumentTypeError("the rates must be positive")
+    return rates
+
+
+def make_frame(rng, kind, corruption):
+    """Builds a frame of a kind, corrupted or not, and the reply it expects ("ACK<code>", "!Mi" or "!Me")."""
+    if kind == "O":
+        payload = "%d%d" % (rng.randint(1, 4), rng.randint(0, 1))
+    elif kind == "A":
+        payload = "".join(str(rng.randint(0, 1)) for _ in range(4))
+    else:
+        payload = ""
+    if corruption is None:
+        return build_frame(kind, payload), "ACK1" if kind in "OA" else "!M" + kind.lower()
+
+    if corruption == "command":
+        kind = "Q"
+    elif corruption == "payload":
+        # a state that is neither 0 nor 1, or an LED out of range
+        if kind == "A":
+            payload = payload[:3] + "7"
+        else:
+            kind, payload = "O", "9%d" % rng.randint(0, 1)
+    frame = build_frame(kind, payload)
+    if corruption == "checksum":
+        good = int(frame[-4:-1])
+        frame = "%s%03d#" % (frame[:-4], (good + 1 + rng.randrange(998)) % 1000)
+    return frame, "ACK" + CORRUPTIONS[corruption]
+
+
+def reply_kind(reply):
+    """Kind of a reply, comparable to the expected one: "ACK<code>", "!Mi", "!Me", or None if it is not valid."""
+    if len(reply) < 8 or not reply[-4:-1].isdigit() or checksum(reply[1:-4]) != int(reply[-4:-1]):
+        return None
+    if reply.startswith("!MZO") and len(reply) == 9:
+        return "ACK" + reply[4]
+    return reply[:3]
+
+
+def percentile(values, fraction):
+    if not values:
+        return 0.0
+    values = sorted(values)
+    return values[min(len(values) - 1, int(fraction * len(values)))]
+
+
+def request(fd, reader, command, payload, timeout):
+    """Sends a frame outside the load and returns its reply, or None."""
+    os.write(fd, build_frame(command, payload).encode())
+    return reader.read(timeout)
+
+
+def drain(reader, timeout):
+    """Discards the replies still arriving from a previous step."""
+    while reader.read(timeout) is not None:
+        pass
+
+
+def run_step(fd, reader, rng, rate, args):
+    """Sends frames at a rate for the step duration, then waits for the last replies."""
+    kinds = [kind for kind, weight in args.mix.items() for _ in range(weight)]
+    corruptions = sorted(CORRUPTIONS)
+    outstanding = []        # (send time, expected reply) of the frames without a reply yet, oldest first
+    result = {"sent": 0, "answered": 0, "lost": 0, "misacked": 0, "bad": 0, "latencies": [], "codes": {}}
+
+    start = time.monotonic()
+    next_send = start
+    end = start + args.duration
+    while True:
+        now = time.monotonic()
+        if now >= next_send and now < end:
+            corruption = rng.choice(corruptions) if rng.random() < args.corrupt else None
+            frame, expected = make_frame(rng, rng.choice(kinds), corruption)
+            os.write(fd, frame.encode())
+            outstanding.append((time.monotonic(), expected))
+            result["sent"] += 1
+            # open loop: a late send is not made up by a burst
+            next_send = max(next_send + 1.0 / rate, now)
+            continue
+        if now >= end and (not outstanding or now >= end + args.timeout):
+            break
+        reply = reader.read(max((next_send if now < end else end + args.timeout) - now, 0))
+        if reply is None:
+            continue
+        received = time.monotonic()
+        kind = reply_kind(reply)
+        if kind is None:
+            result["bad"] += 1
+            continue
+        if kind.startswith("ACK"):
+            result["codes"][kind[3]] = result["codes"].get(kind[3], 0) + 1
+        # the frames before the first one that expects this kind of reply got none
+        while outstanding and outstanding[0][1][:3] != kind[:3]:
+            outstanding.pop(0)
+            result["lost"] += 1
+        if not outstanding:
+            result["bad"] += 1     # a reply to no frame sent in this step
+            continue
+        sent, expected = outstanding.pop(0)
+        result["answered"] += 1
+        result["latencies"].append((received - sent) * 1000.0)
+        if kind != expected:
+            result["misacked"] += 1
+
+    result["lost"] += len(outstanding)
+    result["elapsed"] = time.monotonic() - start
+    return result
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("port", help="serial port or native_sim pseudo-terminal")
+    parser.add_argument("--rates", type=parse_rates, default=parse_rates(DEFAULT_RATES),
+                        help="frames per second of each step, comma separated (default %s)" % DEFAULT_RATES)
+    parser.add_argument("--duration", type=float, default=5.0, help="length of each step in seconds")
+    parser.add_argument("--mix", type=parse_mix, default=parse_mix(DEFAULT_MIX),
+                        help="weights of the frame kinds (default %s)" % DEFAULT_MIX)
+    parser.add_argument("--corrupt", type=float, default=0.1,
+                        help="fraction of the frames corrupted (unknown command, checksum or payload)")
+    parser.add_argument("--timeout", type=float, default=0.5, help="reply timeout in seconds")
+    parser.add_argument("--seed", type=int, default=1, help="seed of the frame mix, for repeatable runs")
+    args = parser.parse_args()
+    if not 0 <= args.corrupt <= 1:
+        parser.error("--corrupt must be between 0 and 1")
+
+    fd = open_port(args.port)
+    reader = FrameReader(fd)
+    rng = random.Random(args.seed)
+    sustained = 0
+    print("%8s %8s %8s %6s %6s %5s %8s %8s %8s %8s %8s %9s  %s" % (
+        "rate/s", "sent/s", "acked/s", "lost", "misack", "bad", "p50 ms", "p90 ms", "p99 ms", "max ms",
+        "jitter", "overruns", "error codes"))
+    for rate in args.rates:
+        drain(reader, args.timeout)
+        request(fd, reader, "S", "R", args.timeout)        # the statistics of the step start from zero
+        result = run_step(fd, reader, rng, rate, args)
+
+        drain(reader, args.timeout)
+        reply = request(fd, reader, "S", "", args.timeout)
+        stats = parse_stats(reply) if reply and reply.startswith("!Ms") else None
+        latencies = result["latencies"]
+        codes = ", ".join("%s %d" % (ACK_CODES.get(code, code), count) for code, count in sorted(result["codes"].items()))
+        print("%8.1f %8.1f %8.1f %6d %6d %5d %8.2f %8.2f %8.2f %8.2f %8s %9s  %s" % (
+            rate, result["sent"] / args.duration, result["answered"] / result["elapsed"],
+            result["lost"], result["misacked"], result["bad"],
+            percentile(latencies, 0.5), percentile(latencies, 0.9), percentile(latencies, 0.99),
+            max(latencies) if latencies else 0.0,
+            "%d us" % stats["release_jitter_us"] if stats else "-",
+            sum(task["overruns"] for task in stats["tasks"]) if stats else "-", codes))
+        if result["lost"] == 0 and result["misacked"] == 0 and result["bad"] == 0:
+            sustained = max(sustained, rate)
+    os.close(fd)
+
+    if sustained:
+        print("highest rate without lost, mis-ACKed or bad replies: %.1f frames/s" % sustained)
+    else:
+        print("frames were lost or mis-ACKed at every rate")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -67,4 +67,113 @@ void RT_db_print(RT_db *db){
     printk("Button1: %d\n",db->button1);
     printk("Button2: %d\n",db->button2);
     printk("Button3: %d\n",db->button3);
-}
\ No newline at end of file
+}
+
+// Packs the LED states into a bitmask (bit i = led i), as expected by the I/O layer
+uint8_t RT_db_get_leds(RT_db *db){
+    return (db->led0 != 0) | ((db->led1 != 0) << 1) | ((db->led2 != 0) << 2) | ((db->led3 != 0) << 3);
+}
+
+// Unpacks a button bitmask (bit i = button i) read by the I/O layer into the database
+void RT_db_set_buttons(RT_db *db, uint8_t button_mask){
+    db->button0 = (button_mask >> 0) & 1;
+    db->button1 = (button_mask >> 1) & 1;
+    db->button2 = (button_mask >> 2) & 1;
+    db->button3 = (button_mask >> 3) & 1;
+}
+
+void RT_db_set_button(RT_db *db, int button_index, int value){
+    switch (button_index) {
+    case 0: db->button0 = value; break;
+    case 1: db->button1 = value; break;
+    case 2: db->button2 = value; break;
+    case 3: db->button3 = value; break;
+    default: break;
+    }
+}
+
+void RT_db_toggle_led(RT_db *db, int led_index){
+    switch (led_index) {
+    case 0: db->led0 = !db->led0; break;
+    case 1: db->led1 = !db->led1; break;
+    case 2: db->led2 = !db->led2; break;
+    case 3: db->led3 = !db->led3; break;
+    default: break;
+    }
+}
+
+// Field of the database by index (enum rtdb_field), or NULL if it does not exist
+int *RT_db_field(RT_db *db, int field){
+    switch (field) {
+    case RTDB_LED0: return &db->led0;
+    case RTDB_LED1: return &db->led1;
+    case RTDB_LED2: return &db->led2;
+    case RTDB_LED3: return &db->led3;
+    case RTDB_BUTTON0: return &db->button0;
+    case RTDB_BUTTON1: return &db->button1;
+    case RTDB_BUTTON2: return &db->button2;
+    case RTDB_BUTTON3: return &db->button3;
+    default: return NULL;
+    }
+}
+
+/************************** LOGICAL EXECUTION TIME ******************************/
+
+// In LET mode the tasks read a snapshot taken at the tick boundary (db_in) and write
+// into a shadow copy (db_out), which only becomes visible at the next tick boundary.
+// Without LET both point to the same database.
+// The swap is not synchronised with the writers, so only the table (its tasks and the tick
+// hook) writes db_out: the writes from outside it are queued and applied by the table.
+static RT_db let_buf[2];
+static RT_db *db_in;
+static RT_db *db_out;
+static int let_enabled = 0;
+
+void RT_db_let_init(RT_db *db, int enable){
+    let_enabled = enable;
+    if(!enable){
+        db_in = db;
+        db_out = db;
+        return;
+    }
+    let_buf[0] = *db;
+    let_buf[1] = *db;
+    db_in = &let_buf[0];
+    db_out = &let_buf[1];
+}
+
+int RT_db_let_enabled(void){
+    return let_enabled;
+}
+
+// Buffer the tasks read from
+RT_db *RT_db_in(void){
+    return db_in;
+}
+
+// Buffer the tasks write to
+RT_db *RT_db_out(void){
+    return db_out;
+}
+
+// Called at the tick boundary: the shadow written during the last tick becomes the new
+// read buffer, and the new shadow starts as a copy of it. Returns the new read buffer.
+RT_db *RT_db_let_swap(void){
+    if(!let_enabled){
+        return db_in;
+    }
+    RT_db *tmp = db_in;
+    db_in = db_out;
+    db_out = tmp;
+    *db_out = *db_in;
+    return db_in;
+}
+
+// Called at the tick boundary, after RT_db_let_swap(): latches an input into the read buffer
+// of the new tick, and into its shadow so that the next swap keeps it.
+void RT_db_let_latch_button(int button_index, int value){
+    RT_db_set_button(db_in, button_index, value);
+    if(db_out != db_in){
+        RT_db_set_button(db_out, button_index, value);
+    }
+}
@@ -0,0 +1,259 @@
+#include "../include/fault_inject.h"
+#include "../include/rtdb.h"
+#include "../include/latency.h"
+
+#include <string.h>
+
+#define FAULT_INJECT_RTDB_VALUE -1      // corrupted value: neither 0 nor 1
+
+// Injection state of a fault kind: only one injection of a kind is followed at a time
+typedef struct {
+    int rate;                   // per-mille of the opportunities
+    fault_inject_stats stats;
+    int pending;                // the last injection is not recovered (or masked) yet
+    int detected;
+    uint32_t inject_cycles;     // cycle count of the injection
+    uint32_t inject_tick;       // tick boundaries seen before the injection
+    int field;                  // RTDB field corrupted (FAULT_INJECT_RTDB)
+} fault_inject_state;
+
+static fault_inject_state faults[FAULT_INJECT_NUM_KINDS] = {
+    [FAULT_INJECT_RTDB] = {.rate = FAULT_INJECT_RTDB_RATE},
+    [FAULT_INJECT_FRAME] = {.rate = FAULT_INJECT_FRAME_RATE},
+    [FAULT_INJECT_EXEC] = {.rate = FAULT_INJECT_EXEC_RATE},
+    [FAULT_INJECT_DELAY] = {.rate = FAULT_INJECT_DELAY_RATE},
+};
+static uint32_t ticks;                      // tick boundaries seen
+static int timing_fault_seen;               // the scheduler reported a timing fault since the last tick boundary
+static uint32_t rand_state = FAULT_INJECT_SEED;
+static struct k_spinlock inject_lock;       // faults are injected and detected by the dispatchers and the tasks
+
+// xorshift32: the same faults on every run (called with inject_lock held)
+static uint32_t fault_inject_rand(void) {
+    rand_state ^= rand_state << 13;
+    rand_state ^= rand_state >> 17;
+    rand_state ^= rand_state << 5;
+    return rand_state;
+}
+
+// Draws whether a fault is injected at this opportunity, and starts following it (called with inject_lock held)
+static int fault_inject_start(int kind) {
+    fault_inject_state *f = &faults[kind];
+
+    if (f->rate == 0 || f->pending || fault_inject_rand() % 1000 >= (uint32_t)f->rate) {
+        return 0;
+    }
+    f->pending = 1;
+    f->detected = 0;
+    f->inject_cycles = k_cycle_get_32();
+    f->inject_tick = ticks;
+    f->stats.injected++;
+    return 1;
+}
+
+// Records the detection of the pending injection of a kind (called with inject_lock held)
+static void fault_inject_detect(int kind) {
+    fault_inject_state *f = &faults[kind];
+
+    if (!f->pending || f->detected) {
+        return;         // a fault that was not injected, or already detected
+    }
+    f->detected = 1;
+    f->stats.detected++;
+    f->stats.max_detection_ticks = MAX(f->stats.max_detection_ticks, ticks - f->inject_tick);
+    latency_record(LATENCY_FAULT_DETECTION, f->inject_cycles);
+}
+
+// Records the recovery from the pending injection of a kind, once it was detected (called with inject_lock held)
+static void fault_inject_recover(int kind) {
+    fault_inject_state *f = &faults[kind];
+
+    if (!f->pending || !f->detected) {
+        return;
+    }
+    f->pending = 0;
+    f->stats.recovered++;
+    f->stats.max_recovery_ticks = MAX(f->stats.max_recovery_ticks, ticks - f->inject_tick);
+    latency_record(LATENCY_FAULT_RECOVERY, f->inject_cycles);
+}
+
+/**
+ * @brief Sets the injection rate of a fault kind.
+ * @param kind Fault kind (enum fault_inject_kind).
+ * @param rate Per-mille of the opportunities (ticks, frames or jobs) where it is injected, 0 to disable it.
+ * @return 0 on success, -EINVAL if the kind or the rate is invalid.
+ */
+int fault_inject_set_rate(int kind, int rate) {
+    if (kind < 0 || kind >= FAULT_INJECT_NUM_KINDS || rate < 0 || rate > 1000) {
+        return -EINVAL;
+    }
+    k_spinlock_key_t key = k_spin_lock(&inject_lock);
+    faults[kind].rate = rate;
+    k_spin_unlock(&inject_lock, key);
+    return 0;
+}
+
+/**
+ * @brief Gets the injection rate of a fault kind.
+ * @param kind Fault kind (enum fault_inject_kind).
+ * @return Rate in per-mille, or -EINVAL if the kind is invalid.
+ */
+int fault_inject_get_rate(int kind) {
+    if (kind < 0 || kind >= FAULT_INJECT_NUM_KINDS) {
+        return -EINVAL;
+    }
+    return faults[kind].rate;
+}
+
+/**
+ * @brief Tick boundary (called from the tick hook, before the tasks of the tick are released):
+ * checks the recoveries and the masked injections, then injects the RTDB corruptions and the
+ * release delays of this tick.
+ */
+void fault_inject_tick(void) {
+    k_spinlock_key_t key = k_spin_lock(&inject_lock);
+    fault_inject_state *rtdb = &faults[FAULT_INJECT_RTDB];
+
+    ticks++;
+    // an RTDB value is recovered once the tasks read it valid again
+    if (rtdb->pending && rtdb->detected) {
+        int value = *RT_db_field(RT_db_in(), rtdb->field);
+        if (value == 0 || value == 1) {
+            fault_inject_recover(FAULT_INJECT_RTDB);
+        }
+    }
+    // a timing fault is recovered at the first tick after its detection without a new one
+    if (!timing_fault_seen) {
+        fault_inject_recover(FAULT_INJECT_EXEC);
+        fault_inject_recover(FAULT_INJECT_DELAY);
+    }
+    timing_fault_seen = 0;
+
+    for (int kind = 0; kind < FAULT_INJECT_NUM_KINDS; kind++) {
+        fault_inject_state *f = &faults[kind];
+        if (f->pending && !f->detected && ticks - f->inject_tick > FAULT_INJECT_TIMEOUT_TICKS) {
+            f->pending = 0;
+            f->stats.masked++;
+        }
+    }
+
+    if (fault_inject_start(FAULT_INJECT_RTDB)) {
+        // in both LET buffers, so that only a repair by the tasks removes it
+        rtdb->field = fault_inject_rand() % RTDB_NUM_FIELDS;
+        *RT_db_field(RT_db_in(), rtdb->field) = FAULT_INJECT_RTDB_VALUE;
+        *RT_db_field(RT_db_out(), rtdb->field) = FAULT_INJECT_RTDB_VALUE;
+    }
+    int delay = fault_inject_start(FAULT_INJECT_DELAY);
+    k_spin_unlock(&inject_lock, key);
+
+    if (delay) {
+        k_busy_wait(FAULT_INJECT_DELAY_US);
+    }
+}
+
+/**
+ * @brief Flips a random bit of a received frame, at the frame rate.
+ * The result of its processing must then be given to fault_inject_frame_checked().
+ * @param frame Frame, modified in place.
+ * @param length Length of the frame.
+ * @return 1 if the frame was corrupted, 0 otherwise.
+ */
+int fault_inject_frame(char *frame, int length) {
+    k_spinlock_key_t key = k_spin_lock(&inject_lock);
+    int flip = length > 0 && fault_inject_start(FAULT_INJECT_FRAME);
+
+    if (flip) {
+        frame[fault_inject_rand() % length] ^= BIT(fault_inject_rand() % 8);
+    }
+    k_spin_unlock(&inject_lock, key);
+    return flip;
+}
+
+/**
+ * @brief Records the outcome of a corrupted frame: rejected (detected, and the next
+ * frame is processed normally), or accepted (masked).
+ * @param rejected 1 if the frame was rejected with an error ACK.
+ */
+void fault_inject_frame_checked(int rejected) {
+    k_spinlock_key_t key = k_spin_lock(&inject_lock);
+    fault_inject_state *f = &faults[FAULT_INJECT_FRAME];
+
+    if (rejected) {
+        fault_inject_detect(FAULT_INJECT_FRAME);
+        fault_inject_recover(FAULT_INJECT_FRAME);
+    } else if (f->pending) {
+        f->pending = 0;
+        f->stats.masked++;
+    }
+    k_spin_unlock(&inject_lock, key);
+}
+
+/**
+ * @brief Inflates the execution time of the calling job, at the exec rate.
+ * Called by the jobs when they start.
+ */
+void fault_inject_exec(void) {
+    k_spinlock_key_t key = k_spin_lock(&inject_lock);
+    int inflate = fault_inject_start(FAULT_INJECT_EXEC);
+    k_spin_unlock(&inject_lock, key);
+
+    if (inflate) {
+        k_busy_wait(FAULT_INJECT_EXEC_US);
+    }
+}
+
+/**
+ * @brief Records the detection of a fault by the system (e.g. job2 finding a corrupted value).
+ * Detections of faults that were not injected are ignored.
+ * @param kind Fault kind (enum fault_inject_kind).
+ */
+void fault_inject_detected(int kind) {
+    if (kind < 0 || kind >= FAULT_INJECT_NUM_KINDS) {
+        return;
+    }
+    k_spinlock_key_t key = k_spin_lock(&inject_lock);
+    fault_inject_detect(kind);
+    k_spin_unlock(&inject_lock, key);
+}
+
+/**
+ * @brief Records a timing fault reported by the scheduler (overrun, late release or missed tick):
+ * it detects the pending exec and delay injections, and delays their recovery to the next tick.
+ */
+void fault_inject_timing_fault(void) {
+    k_spinlock_key_t key = k_spin_lock(&inject_lock);
+    timing_fault_seen = 1;
+    fault_inject_detect(FAULT_INJECT_EXEC);
+    fault_inject_detect(FAULT_INJECT_DELAY);
+    k_spin_unlock(&inject_lock, key);
+}
+
+/**
+ * @brief Gets the outcome of the injections of a fault kind.
+ * The detection and recovery latencies in us are in the LATENCY_FAULT_DETECTION and
+ * LATENCY_FAULT_RECOVERY probes.
+ * @param kind Fault kind (enum fault_inject_kind).
+ * @param stats Where to store the statistics.
+ * @return 0 on success, -EINVAL if the kind is invalid.
+ */
+int fault_inject_get_stats(int kind, fault_inject_stats *stats) {
+    if (kind < 0 || kind >= FAULT_INJECT_NUM_KINDS) {
+        return -EINVAL;
+    }
+    k_spinlock_key_t key = k_spin_lock(&inject_lock);
+    *stats = faults[kind].stats;
+    k_spin_unlock(&inject_lock, key);
+    return 0;
+}
+
+/**
+ * @brief Clears the statistics of all the fault kinds, and stops following their pending injections.
+ */
+void fault_inject_reset_stats(void) {
+    k_spinlock_key_t key = k_spin_lock(&inject_lock);
+    for (int kind = 0; kind < FAULT_INJECT_NUM_KINDS; kind++) {
+        memset(&faults[kind].stats, 0, sizeof(faults[kind].stats));
+        faults[kind].pending = 0;
+    }
+    k_spin_unlock(&inject_lock, key);
+}
@@ -0,0 +1,334 @@
+#include "../include/fault_log.h"
+
+#include <string.h>
+#include <zephyr/storage/flash_map.h>
+
+// The log is a flash circular buffer (FCB) in its own partition, fault_log_partition of the board
+// overlay (never the storage partition of the settings): every FCB entry is a batch of events.
+// Boards without that partition (or without CONFIG_FCB) keep the newest events in RAM only.
+#if defined(CONFIG_FCB) && FIXED_PARTITION_EXISTS(fault_log_partition)
+#define FAULT_LOG_FLASH 1
+#include <zephyr/fs/fcb.h>
+#define FAULT_LOG_PARTITION_ID FIXED_PARTITION_ID(fault_log_partition)
+#define FAULT_LOG_MAGIC 0x53544246      // "STBF"
+#define FAULT_LOG_VERSION 1
+
+static struct fcb log_fcb;
+static struct flash_sector log_sectors[FAULT_LOG_MAX_SECTORS];
+#else
+#define FAULT_LOG_FLASH 0
+#endif
+
+static K_MUTEX_DEFINE(log_mutex);           // the writer, the readers and clear all use the log
+static int log_ready = 0;
+static int log_flash = 0;                   // the log is in flash, else in the RAM ring
+static uint16_t boot;                       // stamped on the events written since this boot
+static atomic_t dropped = ATOMIC_INIT(0);   // events lost since the last batch
+
+// Newest events, when the log is not in flash
+static fault_log_entry ram_log[FAULT_LOG_RAM_SIZE];
+static uint32_t ram_count;                  // events in the ring
+static uint32_t ram_next;                   // where the next event is stored
+
+// Events are queued where they are detected (also by the dispatchers and interrupts) and written later
+K_MSGQ_DEFINE(fault_log_queue, sizeof(fault_log_entry), FAULT_LOG_QUEUE_SIZE, 4);
+static K_SEM_DEFINE(flush_sem, 0, 1);
+
+static void fault_log_task(void *argA, void *argB, void *argC);
+K_THREAD_DEFINE(fault_log_writer, FAULT_LOG_STACK_SIZE, fault_log_task, NULL, NULL, NULL, FAULT_LOG_PRIORITY, 0, 0);
+
+// State of a walk through the log (see fault_log_read())
+typedef struct {
+    fault_log_entry *entries;   // ring of the newest events
+    int max;
+    uint32_t total;
+    uint16_t last_boot;
+} fault_log_walk_state;
+
+// Adds events of the log, oldest first, to the ring of the walk
+static void fault_log_walk_add(fault_log_walk_state *state, const fault_log_entry *events, int n) {
+    for (int i = 0; i < n; i++) {
+        if (state->max > 0) {
+            state->entries[state->total % state->max] = events[i];
+        }
+        state->last_boot = events[i].boot;
+        state->total++;
+    }
+}
+
+#if FAULT_LOG_FLASH
+// Reads a batch of the log into the ring of the walk
+static int fault_log_walk(struct fcb_entry_ctx *loc_ctx, void *arg) {
+    fault_log_entry batch[FAULT_LOG_BATCH_SIZE];
+    int n = MIN(loc_ctx->loc.fe_data_len / sizeof(fault_log_entry), FAULT_LOG_BATCH_SIZE);
+
+    if (flash_area_read(loc_ctx->fap, FCB_ENTRY_FA_DATA_OFF(loc_ctx->loc), batch, n * sizeof(fault_log_entry)) != 0) {
+        return 0;       // an unreadable batch is skipped
+    }
+    fault_log_walk_add(arg, batch, n);
+    return 0;
+}
+
+/**
+ * @brief Appends a batch of events to the log in flash (called with log_mutex held).
+ * When the log is full its oldest sector is dropped.
+ * @param batch Events, with room after them for the padding to the flash write size.
+ * @param n Number of events.
+ * @return 0 on success, or the flash error.
+ */
+static int fault_log_write_flash(fault_log_entry *batch, int n) {
+    struct fcb_entry loc;
+    size_t used = n * sizeof(fault_log_entry);
+    uint16_t length = ROUND_UP(used, MAX(log_fcb.f_align, 1));
+
+    // the entry records the events alone: the FCB reserves the padding itself, and it is not read back
+    int ret = fcb_append(&log_fcb, used, &loc);
+    if (ret == -ENOSPC) {
+        ret = fcb_rotate(&log_fcb);
+        if (ret == 0) {
+            ret = fcb_append(&log_fcb, used, &loc);
+        }
+    }
+    if (ret != 0) {
+        return ret;
+    }
+    memset((uint8_t *)batch + used, log_fcb.f_erase_value, length - used);
+    ret = flash_area_write(log_fcb.fap, FCB_ENTRY_FA_DATA_OFF(loc), batch, length);
+    if (ret != 0) {
+        return ret;
+    }
+    return fcb_append_finish(&log_fcb, &loc);
+}
+
+/**
+ * @brief Opens the log in its partition (called with log_mutex held).
+ * A partition that holds something else is left untouched, unless CONFIG_STBS_FAULT_LOG_FORMAT
+ * allows to erase it and take it over.
+ * @param state Where to count the events already in the log.
+ * @return 0 on success, -ENOMSG if the partition does not hold a log, or the flash error.
+ */
+static int fault_log_open_flash(fault_log_walk_state *state) {
+    uint32_t sector_count = FAULT_LOG_MAX_SECTORS;
+
+    int ret = flash_area_get_sectors(FAULT_LOG_PARTITION_ID, &sector_count, log_sectors);
+    for (int attempt = 0; ret == 0 && attempt < 2; attempt++) {
+        memset(&log_fcb, 0, sizeof(log_fcb));
+        log_fcb.f_magic = FAULT_LOG_MAGIC;
+        log_fcb.f_version = FAULT_LOG_VERSION;
+        log_fcb.f_sectors = log_sectors;
+        log_fcb.f_sector_cnt = sector_count;
+        ret = fcb_init(FAULT_LOG_PARTITION_ID, &log_fcb);
+        if (ret == 0 || attempt > 0 || !IS_ENABLED(CONFIG_STBS_FAULT_LOG_FORMAT)) {
+            break;
+        }
+        const struct flash_area *fa;
+        ret = flash_area_open(FAULT_LOG_PARTITION_ID, &fa);
+        if (ret == 0) {
+            ret = flash_area_erase(fa, 0, fa->fa_size);
+            flash_area_close(fa);
+        }
+    }
+    if (ret == 0) {
+        ret = fcb_walk(&log_fcb, NULL, fault_log_walk, state);
+    }
+    return ret;
+}
+#endif // FAULT_LOG_FLASH
+
+/**
+ * @brief Appends a batch of events to the log (called with log_mutex held).
+ * @param batch Events, with room after them for the padding to the flash write size.
+ * @param n Number of events.
+ * @return 0 on success, or the flash error.
+ */
+static int fault_log_write(fault_log_entry *batch, int n) {
+#if FAULT_LOG_FLASH
+    if (log_flash) {
+        return fault_log_write_flash(batch, n);
+    }
+#endif
+    // the ring keeps the newest events
+    for (int i = 0; i < n; i++) {
+        ram_log[ram_next] = batch[i];
+        ram_next = (ram_next + 1) % FAULT_LOG_RAM_SIZE;
+        ram_count = MIN(ram_count + 1, FAULT_LOG_RAM_SIZE);
+    }
+    return 0;
+}
+
+/**
+ * @brief Writer thread: writes the queued events in batches, as soon as a batch is full
+ * or at most FAULT_LOG_BATCH_MS after they were recorded.
+ */
+static void fault_log_task(void *argA, void *argB, void *argC) {
+    while (1) {
+        k_sem_take(&flush_sem, K_MSEC(FAULT_LOG_BATCH_MS));
+        if (log_ready && (k_msgq_num_used_get(&fault_log_queue) > 0 || atomic_get(&dropped) > 0)) {
+            fault_log_flush();
+        }
+    }
+}
+
+/**
+ * @brief Opens the log in its flash partition, which keeps the events of the previous boots.
+ * A partition that holds something else is left untouched, unless CONFIG_STBS_FAULT_LOG_FORMAT
+ * allows to erase it and take it over. Without the flash log, the newest events are kept in RAM.
+ * @return 0 on success, -ENODEV if the board has no fault_log_partition, -ENOMSG if the partition
+ *         does not hold a log, or the flash error (the log is then kept in RAM).
+ */
+int fault_log_init(void) {
+    fault_log_walk_state state = {0};
+    int ret = -ENODEV;
+
+    k_mutex_lock(&log_mutex, K_FOREVER);
+#if FAULT_LOG_FLASH
+    ret = fault_log_open_flash(&state);
+#endif
+    log_flash = ret == 0;
+    boot = log_flash && state.total > 0 ? state.last_boot + 1 : 0;
+    log_ready = 1;
+    k_mutex_unlock(&log_mutex);
+
+    if (ret == -ENODEV) {
+        printk("Fault log: no fault_log_partition, the events are kept in RAM\n");
+    } else if (ret == -ENOMSG) {
+        printk("Fault log: the partition does not hold a log, left untouched (see CONFIG_STBS_FAULT_LOG_FORMAT)\n");
+    } else if (ret != 0) {
+        printk("Fault log: flash not available (%d)\n", ret);
+    } else {
+        printk("Fault log: %u events, boot %u\n", state.total, boot);
+    }
+    return ret;
+}
+
+/**
+ * @brief Records an event. It is only queued, so it can be called from any context
+ * (interrupts, the dispatchers): the writer thread stores it in the log later.
+ * @param event Event (enum fault_log_event).
+ * @param source Task or field the event is about.
+ * @param value Value of the event.
+ */
+void fault_log_record(int event, int source, int value) {
+    fault_log_entry e = {.uptime_ms = k_uptime_get_32(), .event = event, .source = source, .value = value};
+
+    if (k_msgq_put(&fault_log_queue, &e, K_NO_WAIT) != 0) {
+        atomic_inc(&dropped);
+        return;
+    }
+    if (k_msgq_num_used_get(&fault_log_queue) >= FAULT_LOG_BATCH_SIZE) {
+        k_sem_give(&flush_sem);
+    }
+}
+
+/**
+ * @brief Writes the queued events to the log now, and the number of events lost, if any.
+ * @return 0 on success, -ENODEV if the log was not opened, or the flash error.
+ */
+int fault_log_flush(void) {
+    fault_log_entry batch[FAULT_LOG_BATCH_SIZE + 1];    // room for the padding of the write
+    int ret = 0;
+
+    if (!log_ready) {
+        return -ENODEV;
+    }
+    k_mutex_lock(&log_mutex, K_FOREVER);
+    while (ret == 0) {
+        int n = 0;
+        while (n < FAULT_LOG_BATCH_SIZE && k_msgq_get(&fault_log_queue, &batch[n], K_NO_WAIT) == 0) {
+            n++;
+        }
+        if (n < FAULT_LOG_BATCH_SIZE && atomic_get(&dropped) > 0) {
+            batch[n++] = (fault_log_entry){.uptime_ms = k_uptime_get_32(), .event = FAULT_LOG_DROPPED,
+                                           .value = atomic_clear(&dropped)};
+        }
+        if (n == 0) {
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            batch[i].boot = boot;
+        }
+        ret = fault_log_write(batch, n);
+    }
+    k_mutex_unlock(&log_mutex);
+    return ret;
+}
+
+// Reverses the events from first to last - 1
+static void fault_log_reverse(fault_log_entry *entries, int first, int last) {
+    while (first < --last) {
+        fault_log_entry e = entries[first];
+        entries[first++] = entries[last];
+        entries[last] = e;
+    }
+}
+
+/**
+ * @brief Reads the newest events of the log (the ones still queued are not included, see fault_log_flush()).
+ * @param entries Where to store the events, oldest first.
+ * @param max Maximum number of events to read.
+ * @param total Where to store the number of events in the log, or NULL.
+ * @return Number of events read, -EINVAL if max is negative, -ENODEV if the log was not opened, or the flash error.
+ */
+int fault_log_read(fault_log_entry *entries, int max, uint32_t *total) {
+    fault_log_walk_state state = {.entries = entries, .max = max};
+    int ret = 0;
+
+    if (max < 0) {
+        return -EINVAL;
+    }
+    if (!log_ready) {
+        return -ENODEV;
+    }
+    k_mutex_lock(&log_mutex, K_FOREVER);
+#if FAULT_LOG_FLASH
+    if (log_flash) {
+        ret = fcb_walk(&log_fcb, NULL, fault_log_walk, &state);
+    }
+#endif
+    if (!log_flash) {
+        uint32_t oldest = (ram_next + FAULT_LOG_RAM_SIZE - ram_count) % FAULT_LOG_RAM_SIZE;
+        for (uint32_t i = 0; i < ram_count; i++) {
+            fault_log_walk_add(&state, &ram_log[(oldest + i) % FAULT_LOG_RAM_SIZE], 1);
+        }
+    }
+    k_mutex_unlock(&log_mutex);
+    if (ret != 0) {
+        return ret;
+    }
+
+    if (state.total > (uint32_t)max && max > 0) {
+        // the ring wrapped: its oldest event is after the newest one
+        int oldest = state.total % max;
+        fault_log_reverse(entries, 0, oldest);
+        fault_log_reverse(entries, oldest, max);
+        fault_log_reverse(entries, 0, max);
+    }
+    if (total) {
+        *total = state.total;
+    }
+    return MIN(state.total, (uint32_t)max);
+}
+
+/**
+ * @brief Erases all the events of the log (the ones still queued are kept).
+ * @return 0 on success, -ENODEV if the log was not opened, or the flash error.
+ */
+int fault_log_clear(void) {
+    int ret = 0;
+
+    if (!log_ready) {
+        return -ENODEV;
+    }
+    k_mutex_lock(&log_mutex, K_FOREVER);
+#if FAULT_LOG_FLASH
+    if (log_flash) {
+        ret = fcb_clear(&log_fcb);
+    }
+#endif
+    if (!log_flash) {
+        ram_count = 0;
+        ram_next = 0;
+    }
+    k_mutex_unlock(&log_mutex);
+    return ret;
+}
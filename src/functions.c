@@ -24,7 +24,7 @@ int gcd(int a, int b) {
 
 // Function to calculate LCM of two numbers
 int lcm(int a, int b) {
-    return (a * b) / gcd(a, b);
+    return (a / gcd(a, b)) * b;     // divide first to avoid overflowing a * b
 }
 
 // Function to calculate LCM of an array of numbers
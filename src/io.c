@@ -0,0 +1,288 @@
+#include "../include/io.h"
+
+#include <zephyr/device.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/drivers/gpio.h>
+#include <string.h>
+
+// LEDS
+static const struct gpio_dt_spec leds[IO_NUM_LEDS] = {
+    GPIO_DT_SPEC_GET(DT_ALIAS(led0), gpios),
+    GPIO_DT_SPEC_GET(DT_ALIAS(led1), gpios),
+    GPIO_DT_SPEC_GET(DT_ALIAS(led2), gpios),
+    GPIO_DT_SPEC_GET(DT_ALIAS(led3), gpios),
+};
+
+// BUTTONS
+static const struct gpio_dt_spec buttons[IO_NUM_BUTTONS] = {
+    GPIO_DT_SPEC_GET(DT_ALIAS(sw0), gpios),
+    GPIO_DT_SPEC_GET(DT_ALIAS(sw1), gpios),
+    GPIO_DT_SPEC_GET(DT_ALIAS(sw2), gpios),
+    GPIO_DT_SPEC_GET(DT_ALIAS(sw3), gpios),
+};
+
+typedef struct {
+    const struct device *port;
+    gpio_port_pins_t out_mask;      // pins of this port driven by LEDs
+    gpio_port_pins_t in_mask;       // pins of this port sampled as buttons
+    gpio_port_pins_t led_pin[IO_NUM_LEDS];        // port bit of each LED (0 if not on this port)
+    gpio_port_pins_t button_pin[IO_NUM_BUTTONS];  // port bit of each button (0 if not on this port)
+    struct gpio_callback button_cb;                 // edge interrupt callback for in_mask
+} io_port;
+
+static io_port ports[IO_MAX_PORTS];
+static int num_ports;
+
+// Button edge capture
+K_MSGQ_DEFINE(button_events, sizeof(button_event), IO_EVENT_QUEUE_LEN, 4);
+static uint32_t debounce_cycles;
+static uint32_t last_edge[IO_NUM_BUTTONS];      // timestamp of the last accepted edge
+static uint8_t last_level[IO_NUM_BUTTONS];      // last level reported to the queue
+static uint32_t bounce_edge[IO_NUM_BUTTONS];    // timestamp of the last raw edge inside the debounce window
+static struct k_timer settle_timer[IO_NUM_BUTTONS];
+static uint32_t dropped_events;
+static struct k_spinlock edge_lock;
+
+/**
+ * @brief Returns the port entry of a device, adding it to the port list if needed.
+ */
+static io_port *io_get_port(const struct device *dev) {
+    for (int i = 0; i < num_ports; i++) {
+        if (ports[i].port == dev) {
+            return &ports[i];
+        }
+    }
+    ports[num_ports].port = dev;
+    return &ports[num_ports++];
+}
+
+/**
+ * @brief Configures all the LED and button pins and precomputes the per-port masks.
+ * @return 0 on success, negative error code otherwise.
+ */
+int io_init(void) {
+    int ret;
+
+    num_ports = 0;
+    memset(ports, 0, sizeof(ports));
+
+    /* Configure the GPIOs of the LEDs */
+    for (int i = 0; i < IO_NUM_LEDS; i++) {
+        if (!device_is_ready(leds[i].port)) {
+            printk("GPIO device is not ready\r\n");
+            return -ENODEV;
+        }
+        ret = gpio_pin_configure_dt(&leds[i], GPIO_OUTPUT_ACTIVE);
+        if (ret < 0) {
+            return ret;
+        }
+        io_port *p = io_get_port(leds[i].port);
+        p->led_pin[i] = BIT(leds[i].pin);
+        p->out_mask |= BIT(leds[i].pin);
+    }
+
+    /* Configure the GPIOs of the buttons */
+    for (int i = 0; i < IO_NUM_BUTTONS; i++) {
+        if (!device_is_ready(buttons[i].port)) {
+            printk("GPIO device is not ready\r\n");
+            return -ENODEV;
+        }
+        ret = gpio_pin_configure_dt(&buttons[i], GPIO_INPUT);
+        if (ret < 0) {
+            return ret;
+        }
+        io_port *p = io_get_port(buttons[i].port);
+        p->button_pin[i] = BIT(buttons[i].pin);
+        p->in_mask |= BIT(buttons[i].pin);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Writes all the LEDs with one masked write per port.
+ * @param led_mask Bit i holds the logical state of LED i.
+ * @return 0 on success, negative error code of the first failed port write.
+ */
+int io_write_leds(uint8_t led_mask) {
+    int ret = 0;
+
+    for (int i = 0; i < num_ports; i++) {
+        if (!ports[i].out_mask) {
+            continue;
+        }
+        gpio_port_value_t value = 0;
+        for (int led = 0; led < IO_NUM_LEDS; led++) {
+            if (led_mask & BIT(led)) {
+                value |= ports[i].led_pin[led];
+            }
+        }
+        int err = gpio_port_set_masked(ports[i].port, ports[i].out_mask, value);
+        if (err && !ret) {
+            ret = err;
+        }
+    }
+    return ret;
+}
+
+/**
+ * @brief Reads all the buttons with one read per port.
+ * @return Bit i holds the logical state of button i (ports that fail to read report 0).
+ */
+uint8_t io_read_buttons(void) {
+    uint8_t button_mask = 0;
+
+    for (int i = 0; i < num_ports; i++) {
+        if (!ports[i].in_mask) {
+            continue;
+        }
+        gpio_port_value_t value;
+        if (gpio_port_get(ports[i].port, &value) < 0) {
+            continue;
+        }
+        for (int button = 0; button < IO_NUM_BUTTONS; button++) {
+            if (value & ports[i].button_pin[button]) {
+                button_mask |= BIT(button);
+            }
+        }
+    }
+    return button_mask;
+}
+
+
+/**
+ * @brief Queues a button edge if the level differs from the last reported one.
+ * Called from interrupt context (GPIO callback or settle timer).
+ * @param now Cycle count of the call, checked against the debounce window.
+ * @param edge Cycle count of the raw edge the level comes from, used as its timestamp.
+ */
+static void io_report_edge(int button, uint32_t now, uint32_t edge) {
+    k_spinlock_key_t key = k_spin_lock(&edge_lock);
+    int level = gpio_pin_get_dt(&buttons[button]);
+
+    if (level < 0 || level == last_level[button]) {
+        k_spin_unlock(&edge_lock, key);
+        return;         // read error or bounce back to the reported level
+    }
+
+    if (now - last_edge[button] < debounce_cycles) {
+        // still bouncing: check again once the window expires
+        bounce_edge[button] = edge;
+        uint32_t remaining = debounce_cycles - (now - last_edge[button]);
+        k_timer_start(&settle_timer[button], K_CYC(remaining), K_NO_WAIT);
+        k_spin_unlock(&edge_lock, key);
+        return;
+    }
+
+    button_event evt = {
+        .timestamp = edge,
+        .button = button,
+        .level = level,
+    };
+    last_edge[button] = edge;
+    last_level[button] = level;
+    if (k_msgq_put(&button_events, &evt, K_NO_WAIT) != 0) {
+        dropped_events++;
+    }
+    k_spin_unlock(&edge_lock, key);
+}
+
+static void io_settle_expired(struct k_timer *timer) {
+    int button = timer - settle_timer;
+
+    // the level settled at the last edge seen while bouncing, not when the window expired
+    io_report_edge(button, k_cycle_get_32(), bounce_edge[button]);
+}
+
+static void io_button_isr(const struct device *dev, struct gpio_callback *cb, gpio_port_pins_t pins) {
+    uint32_t now = k_cycle_get_32();
+    io_port *p = CONTAINER_OF(cb, io_port, button_cb);
+
+    for (int button = 0; button < IO_NUM_BUTTONS; button++) {
+        if (pins & p->button_pin[button]) {
+            io_report_edge(button, now, now);
+        }
+    }
+}
+
+/**
+ * @brief Sets the minimum time between two accepted edges of the same button.
+ * @param debounce_us Debounce window in microseconds.
+ */
+void io_set_debounce_us(uint32_t debounce_us) {
+    debounce_cycles = k_us_to_cyc_ceil32(debounce_us);
+}
+
+/**
+ * @brief Enables the edge interrupts of the buttons.
+ * Every debounced edge is timestamped and queued, to be consumed with io_get_button_event().
+ * Must be called after io_init().
+ * @param debounce_us Debounce window in microseconds.
+ * @return 0 on success, negative error code otherwise.
+ */
+int io_buttons_irq_init(uint32_t debounce_us) {
+    int ret;
+    uint8_t levels = io_read_buttons();
+    uint32_t now = k_cycle_get_32();
+
+    io_set_debounce_us(debounce_us);
+    dropped_events = 0;
+    k_msgq_purge(&button_events);
+
+    for (int i = 0; i < IO_NUM_BUTTONS; i++) {
+        last_level[i] = (levels >> i) & 1;
+        last_edge[i] = now - debounce_cycles;
+        k_timer_init(&settle_timer[i], io_settle_expired, NULL);
+
+        ret = gpio_pin_interrupt_configure_dt(&buttons[i], GPIO_INT_EDGE_BOTH);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+
+    for (int i = 0; i < num_ports; i++) {
+        if (!ports[i].in_mask) {
+            continue;
+        }
+        gpio_init_callback(&ports[i].button_cb, io_button_isr, ports[i].in_mask);
+        ret = gpio_add_callback(ports[i].port, &ports[i].button_cb);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Takes the oldest queued button edge, without blocking.
+ * @param evt Where to store the event.
+ * @return 0 if an event was returned, -ENOMSG if the queue is empty.
+ */
+int io_get_button_event(button_event *evt) {
+    return k_msgq_get(&button_events, evt, K_NO_WAIT);
+}
+
+/**
+ * @brief Takes the oldest queued button edge if it happened before a given instant.
+ * Edges captured after the cutoff stay queued for the next call.
+ * @param evt Where to store the event.
+ * @param cutoff Cycle counter value (k_cycle_get_32) of the cutoff instant.
+ * @return 0 if an event was returned, -ENOMSG if there is no event up to the cutoff.
+ */
+int io_get_button_event_until(button_event *evt, uint32_t cutoff) {
+    if (k_msgq_peek(&button_events, evt) != 0) {
+        return -ENOMSG;
+    }
+    if ((int32_t)(evt->timestamp - cutoff) > 0) {
+        return -ENOMSG;
+    }
+    // single consumer: the peeked event is still at the head of the queue
+    return k_msgq_get(&button_events, evt, K_NO_WAIT);
+}
+
+/**
+ * @brief Returns the number of edges lost because the queue was full.
+ */
+uint32_t io_get_dropped_events(void) {
+    return dropped_events;
+}
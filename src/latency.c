@@ -0,0 +1,126 @@
+#include "../include/latency.h"
+
+#include <string.h>
+
+typedef struct {
+    uint32_t bucket[LATENCY_NUM_BUCKETS];
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+} latency_histogram;
+
+static latency_histogram histograms[LATENCY_NUM_PROBES];
+static struct k_spinlock latency_lock;     // probes are recorded from interrupts and tasks
+
+/**
+ * @brief Histogram bucket of a latency: values below 4 us have their own bucket,
+ * every power of two above is split in 4 buckets.
+ */
+static int latency_bucket(uint32_t us) {
+    if (us < (1u << LATENCY_SUB_BUCKETS_LOG2)) {
+        return us;
+    }
+    int msb = 31 - __builtin_clz(us);
+    int sub = (us >> (msb - LATENCY_SUB_BUCKETS_LOG2)) & ((1 << LATENCY_SUB_BUCKETS_LOG2) - 1);
+    return ((msb - LATENCY_SUB_BUCKETS_LOG2 + 1) << LATENCY_SUB_BUCKETS_LOG2) + sub;
+}
+
+// Largest latency counted in a bucket, in us
+static uint32_t latency_bucket_max(int bucket) {
+    if (bucket < (1 << LATENCY_SUB_BUCKETS_LOG2)) {
+        return bucket;
+    }
+    int shift = (bucket >> LATENCY_SUB_BUCKETS_LOG2) - 1;
+    int sub = bucket & ((1 << LATENCY_SUB_BUCKETS_LOG2) - 1);
+    return ((((1u << LATENCY_SUB_BUCKETS_LOG2) + sub + 1)) << shift) - 1;
+}
+
+/**
+ * @brief Records a latency in microseconds.
+ * @param probe Path the latency was measured on (enum latency_probe).
+ * @param us Latency in microseconds.
+ */
+void latency_record_us(int probe, uint32_t us) {
+    if (probe < 0 || probe >= LATENCY_NUM_PROBES) {
+        return;
+    }
+    us = MIN(us, LATENCY_MAX_US);
+
+    k_spinlock_key_t key = k_spin_lock(&latency_lock);
+    latency_histogram *h = &histograms[probe];
+    if (h->count == 0 || us < h->min_us) {
+        h->min_us = us;
+    }
+    h->max_us = MAX(h->max_us, us);
+    h->count++;
+    h->bucket[latency_bucket(us)]++;
+    k_spin_unlock(&latency_lock, key);
+}
+
+/**
+ * @brief Records the latency from a cycle counter timestamp until now.
+ * Can be called from interrupts.
+ * @param probe Path the latency was measured on (enum latency_probe).
+ * @param start_cycles Cycle counter (k_cycle_get_32) at the start of the path.
+ */
+void latency_record(int probe, uint32_t start_cycles) {
+    latency_record_us(probe, k_cyc_to_us_floor32(k_cycle_get_32() - start_cycles));
+}
+
+/**
+ * @brief Computes the minimum, maximum and percentiles of the latencies recorded by a probe.
+ * The percentiles are the upper bound of their histogram bucket.
+ * @param probe Probe to summarize.
+ * @param summary Where to store the summary (all 0 if nothing was recorded).
+ * @return 0 on success, -EINVAL if the probe does not exist.
+ */
+int latency_get_summary(int probe, latency_summary *summary) {
+    static const int percentile[3] = {50, 90, 99};
+    uint32_t *value[3] = {&summary->p50_us, &summary->p90_us, &summary->p99_us};
+
+    if (probe < 0 || probe >= LATENCY_NUM_PROBES) {
+        return -EINVAL;
+    }
+    memset(summary, 0, sizeof(*summary));
+
+    k_spinlock_key_t key = k_spin_lock(&latency_lock);
+    latency_histogram *h = &histograms[probe];
+    summary->count = h->count;
+    summary->min_us = h->min_us;
+    summary->max_us = h->max_us;
+
+    for (int p = 0; p < 3 && h->count > 0; p++) {
+        uint32_t rank = ((uint64_t)h->count * percentile[p] + 99) / 100;   // rank of the sample, from 1
+        uint32_t seen = 0;
+
+        for (int b = 0; b < LATENCY_NUM_BUCKETS; b++) {
+            seen += h->bucket[b];
+            if (seen >= rank) {
+                *value[p] = CLAMP(latency_bucket_max(b), h->min_us, h->max_us);
+                break;
+            }
+        }
+    }
+    k_spin_unlock(&latency_lock, key);
+    return 0;
+}
+
+/**
+ * @brief Clears the latencies recorded by a probe.
+ * @param probe Probe to clear, or -1 for all of them.
+ * @return 0 on success, -EINVAL if the probe does not exist.
+ */
+int latency_reset(int probe) {
+    if (probe < -1 || probe >= LATENCY_NUM_PROBES) {
+        return -EINVAL;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&latency_lock);
+    if (probe < 0) {
+        memset(histograms, 0, sizeof(histograms));
+    } else {
+        memset(&histograms[probe], 0, sizeof(histograms[probe]));
+    }
+    k_spin_unlock(&latency_lock, key);
+    return 0;
+}
@@ -26,39 +26,110 @@
 #include "../include/stb_scheduler.h"
 #include "../include/frames.h"
 #include "../include/rtdb.h"
+#include "../include/io.h"
+#include "../include/latency.h"
+#include "../include/fault_log.h"
+#include "../include/fault_inject.h"
 #include "zephyr/sys/sys_io.h"
 
 // GLOBAL
 
 RT_db rtdb;
 
+// Latency probes
+static uint32_t frame_start;                        // cycle count of the first byte of the frame being processed
+static uint32_t led_press[IO_NUM_LEDS];             // cycle count of the press that toggled each LED
+static atomic_t led_press_pending = ATOMIC_INIT(0); // LEDs toggled by a press and not written yet
+static char last_ack;                               // error code of the last ACK sent
+static atomic_t led_commands = ATOMIC_INIT(0);      // LED writes of the frames not applied yet (see queue_led_command())
+
 /************************************  UART  ***********************************/
 #define SLEEP_TIME_MS 1000
 #define RECEIVE_BUFF_SIZE 10
 #define RECEIVE_TIMEOUT 100
 #define INPUT_BUFFER_SIZE 20
+#define STATS_MAX_TASKS 15      // tasks reported by the statistics frame
+#define STATS_MAX_TICKS 16      // table ticks whose slack is reported by the statistics frame
+#define FRAME_QUEUE_SIZE 4      // complete frames waiting for the protocol task
+#define FAULT_FRAME_MAX_EVENTS 8    // newest events sent by the fault log frame
+#define TX_BUFFER_SIZE (4 + 30 + 32 * STATS_MAX_TASKS + 2 + 8 * STATS_MAX_TICKS + 5)  // biggest reply (the statistics frame)
+#define TX_TIMEOUT_MS 100       // longest wait for the previous reply to leave the UART
+#ifdef CONFIG_STBS_FAULT_INJECT
+static const char fault_inject_kinds[] = "RFED";   // fault kind of each letter of the X frame (enum fault_inject_kind)
+#endif
 
+// Complete frame handed by the UART callback to the protocol task
+typedef struct {
+    char data[INPUT_BUFFER_SIZE];
+    int length;
+    uint32_t start;             // cycle count of its first byte
+} rx_frame;
 
+K_MSGQ_DEFINE(frame_queue, sizeof(rx_frame), FRAME_QUEUE_SIZE, 4);
+// Button edges latched at the tick boundaries and not consumed by job1 yet (LET mode)
+K_MSGQ_DEFINE(let_events, sizeof(button_event), IO_EVENT_QUEUE_LEN, 4);
+// Given when the UART is free to send the next reply (UART_TX_DONE/UART_TX_ABORTED)
+K_SEM_DEFINE(tx_done, 1, 1);
 
 
-// LEDS
-static const struct gpio_dt_spec led0 = GPIO_DT_SPEC_GET(DT_ALIAS(led0), gpios);
-static const struct gpio_dt_spec led1 = GPIO_DT_SPEC_GET(DT_ALIAS(led1), gpios);
-static const struct gpio_dt_spec led2 = GPIO_DT_SPEC_GET(DT_ALIAS(led2), gpios);
-static const struct gpio_dt_spec led3 = GPIO_DT_SPEC_GET(DT_ALIAS(led3), gpios);
-
-// BUTTONS
-static const struct gpio_dt_spec button0 = GPIO_DT_SPEC_GET(DT_ALIAS(sw0), gpios);
-static const struct gpio_dt_spec button1 = GPIO_DT_SPEC_GET(DT_ALIAS(sw1), gpios);
-static const struct gpio_dt_spec button2 = GPIO_DT_SPEC_GET(DT_ALIAS(sw2), gpios);
-static const struct gpio_dt_spec button3 = GPIO_DT_SPEC_GET(DT_ALIAS(sw3), gpios);
-
 
 
 const struct device *uart= DEVICE_DT_GET(DT_NODELABEL(uart0));
 
 /************************** FRAME PROCESSING ******************************/
 
+/**
+ * Send a reply over UART. The frames are processed back to back, so the reply waits for the
+ * previous one to leave the UART (the async driver takes one transmission at a time) and is
+ * copied to the transmit buffer, which the caller's buffer may be rewritten after.
+ * @param data Reply to send
+ * @param length Length of the reply
+ * @return 0 on success, -EMSGSIZE if the reply does not fit the transmit buffer,
+ *         -EAGAIN if the previous reply did not leave in time, or the error of uart_tx()
+ */
+static int uart_send(const char *data, int length) {
+    static char tx_buffer[TX_BUFFER_SIZE];
+
+    if (length > sizeof(tx_buffer)) {
+        return -EMSGSIZE;
+    }
+    if (k_sem_take(&tx_done, K_MSEC(TX_TIMEOUT_MS)) != 0) {
+        return -EAGAIN;
+    }
+    memcpy(tx_buffer, data, length);
+    int ret = uart_tx(uart, tx_buffer, length, SYS_FOREVER_MS);
+    if (ret != 0) {
+        k_sem_give(&tx_done);   // nothing is being sent
+    }
+    return ret;
+}
+
+#ifdef CONFIG_STBS_FAULT_INJECT
+/**
+ * Parse the payload of a fault injection rate frame: <kind letter (R, F, E or D)><rate in per-mille, 4 digits>.
+ * @param payload Payload of the frame
+ * @param kind Where to store the fault kind (enum fault_inject_kind)
+ * @param rate Where to store the rate
+ * @return true if the payload is valid
+ */
+static bool parse_fault_rate(const char *payload, int *kind, int *rate) {
+    const char *letter = payload[0] != '\0' ? strchr(fault_inject_kinds, payload[0]) : NULL;
+
+    if (!letter) {
+        return false;
+    }
+    *rate = 0;
+    for (int i = 1; i <= 4; i++) {
+        if (!isdigit(payload[i])) {
+            return false;
+        }
+        *rate = *rate * 10 + payload[i] - '0';
+    }
+    *kind = letter - fault_inject_kinds;
+    return true;
+}
+#endif
+
 /**
  * Process a frame received over UART.
  * @param frame Frame to process
@@ -68,10 +139,6 @@ const struct device *uart= DEVICE_DT_GET(DT_NODELABEL(uart0));
  */
 void process_frame(const char *frame, int frame_length) {
 
-    if(!strcmp(frame,"!PO13#")){
-        frame = "!PO53#";      // change a character to simulate corrupted data 
-        // printk("new frame: %s\n",frame);
-    }
     // Validate frame structure
     if (frame_length < 5 || frame[0] != '!' || frame[frame_length - 1] != '#' ||
         !isdigit(frame[frame_length - 4]) ||
@@ -117,9 +184,11 @@ void process_frame(const char *frame, int frame_length) {
         memcpy(payloadB, &frame[3], frame_length - 7);  
         
         if (validate_led_states(payloadB)) {
+            uint8_t states = 0;
             for (int i = 0; i < 4; i++) {
-                set_led(i, payloadB[i]-'0');
+                states |= (payloadB[i] - '0') << i;
             }
+            set_leds(states);   // one write, so the table never sees a part of the pattern
             send_ack('1'); // Acknowledge success
         } else {
             send_ack('4'); // Invalid payload
@@ -134,8 +203,59 @@ void process_frame(const char *frame, int frame_length) {
         send_outputs();
         break;
 
-    case 'C':
-        rtdb.led0 = -1;
+#ifdef CONFIG_STBS_FAULT_INJECT
+    case 'X': // Fault injection: read the statistics, "XZ": reset them, "X<kind><rate:4>": set a rate (per-mille)
+        int kind, rate;
+        if (frame_length == 7) {
+            send_fault_injection();
+        } else if (frame_length == 8 && frame[3] == 'Z') {
+            fault_inject_reset_stats();
+            send_ack('1');
+        } else if (frame_length == 12 && parse_fault_rate(&frame[3], &kind, &rate) &&
+                   fault_inject_set_rate(kind, rate) == 0) {
+            send_ack('1');
+        } else {
+            send_ack('4'); // Invalid payload
+        }
+        break;
+#endif
+
+    case 'F': // Read the fault log ("FC": clear it)
+        if (frame_length == 7) {
+            send_faults();
+        } else if (frame_length == 8 && frame[3] == 'C') {
+            send_ack(fault_log_clear() == 0 ? '1' : '4');
+        } else {
+            send_ack('4'); // Invalid payload
+        }
+        break;
+
+    case 'L': // Read the latency histogram of a probe
+        if (frame_length == 8 && frame[3] >= '0' && frame[3] < '0' + LATENCY_NUM_PROBES) {
+            send_latency(frame[3] - '0');
+        } else {
+            send_ack('4'); // Invalid payload
+        }
+        break;
+
+    case 'S': // Read the scheduler statistics ("SR": read and reset them)
+        if (frame_length == 7 || (frame_length == 8 && frame[3] == 'R')) {
+            send_stats(frame_length == 8);
+        } else {
+            send_ack('4'); // Invalid payload
+        }
+        break;
+
+    case 'R': // Reset the latency histogram of a probe (all of them without payload)
+        if (frame_length == 7) {
+            latency_reset(-1);
+            send_ack('1');
+        } else if (frame_length == 8 && frame[3] >= '0' && frame[3] < '0' + LATENCY_NUM_PROBES) {
+            latency_reset(frame[3] - '0');
+            send_ack('1');
+        } else {
+            send_ack('4'); // Invalid payload
+        }
         break;
 
     default:
@@ -166,6 +286,7 @@ int calculate_checksum(const char *frame, int length) {
  */
 void send_ack(char error_code) {
     static char ack_frame[20]; // Ensure a static buffer is used
+    last_ack = error_code;
     snprintf(ack_frame, sizeof(ack_frame), "!MZO%c000#", error_code);
 
     int checksum = calculate_checksum(ack_frame, strlen(ack_frame) - 4);
@@ -173,28 +294,97 @@ void send_ack(char error_code) {
     ack_frame[6] = '0' + ((checksum / 10) % 10);
     ack_frame[7] = '0' + (checksum % 10);
     
-    int ret = uart_tx(uart, ack_frame, strlen(ack_frame), SYS_FOREVER_MS);
+    int ret = uart_send(ack_frame, strlen(ack_frame));
     if (ret != 0) {
         printk("UART TX failed with error: %d\n", ret);
+        return;
+    }
+    latency_record(LATENCY_FRAME_TO_ACK, frame_start);
+}
+
+/**
+ * Send the latency histogram summary of a probe over UART.
+ * Frame: !Ml<probe><count><min><p50><p90><p99><max><checksum>#, every figure in 6 digits
+ * (microseconds for the latencies, saturated at 999999).
+ * @param probe Probe to send (enum latency_probe)
+ */
+void send_latency(int probe) {
+    static char latency_frame[48];
+    latency_summary s;
+
+    latency_get_summary(probe, &s);
+    snprintf(latency_frame, sizeof(latency_frame), "!Ml%d%06u%06u%06u%06u%06u%06u000#", probe,
+        MIN(s.count, 999999u), MIN(s.min_us, 999999u), MIN(s.p50_us, 999999u),
+        MIN(s.p90_us, 999999u), MIN(s.p99_us, 999999u), MIN(s.max_us, 999999u));
+
+    // Update checksum
+    int length = strlen(latency_frame);
+    int checksum = calculate_checksum(latency_frame, length - 4);
+    latency_frame[length - 4] = '0' + (checksum / 100);
+    latency_frame[length - 3] = '0' + ((checksum / 10) % 10);
+    latency_frame[length - 2] = '0' + (checksum % 10);
+
+    int err = uart_send(latency_frame, length);
+    if (err) {
+        printk("uart_tx() error. Error code:%d\n\r",err);
     }
 }
 
 
+#define LED_COMMAND_MASK_SHIFT 4    // led_commands: LEDs to write in bits 4-7, their new states in bits 0-3
+
+/**
+ * Queue a write of some LEDs. The frames are processed outside the table, so they never write
+ * the RTDB themselves: the table applies the queued writes all at once (see apply_led_commands()).
+ * @param mask LEDs to write (bit i: LED i)
+ * @param values New states of the LEDs in the mask (bit i: LED i)
+ */
+static void queue_led_command(uint8_t mask, uint8_t values) {
+    atomic_val_t old, new;
+
+    do {
+        old = atomic_get(&led_commands);
+        uint8_t pending = (old >> LED_COMMAND_MASK_SHIFT) | mask;
+        uint8_t states = (old & ~mask) | (values & mask);
+        new = (pending << LED_COMMAND_MASK_SHIFT) | (states & BIT_MASK(IO_NUM_LEDS));
+    } while (!atomic_cas(&led_commands, old, new));
+}
+
+/**
+ * Apply the LED writes queued by the frames, all of them in one step.
+ * Called by job0, or at the tick boundary before the swap in LET mode.
+ * @param db Database the LED states are written to
+ */
+static void apply_led_commands(RT_db *db) {
+    atomic_val_t commands = atomic_clear(&led_commands);
+    uint8_t mask = commands >> LED_COMMAND_MASK_SHIFT;
+
+    for (int i = 0; i < IO_NUM_LEDS; i++) {
+        if (mask & BIT(i)) {
+            *RT_db_field(db, RTDB_LED0 + i) = (commands >> i) & 1;
+        }
+    }
+}
+
 /**
- * Set the state of an LED.
+ * Set the state of an LED. The write is queued and applied by the table in its next tick.
  * @param led_index Index of the LED (0-3)
  * @param value New state of the LED (0 or 1)
  */
 void set_led(int led_index, int value) {
-    switch (led_index) {
-    case 0: rtdb.led0 = value; break;
-    case 1: rtdb.led1 = value; break;
-    case 2: rtdb.led2 = value; break;
-    case 3: rtdb.led3 = value; break;
-    default: break;
+    if (led_index >= 0 && led_index < IO_NUM_LEDS) {
+        queue_led_command(BIT(led_index), value ? BIT(led_index) : 0);
     }
 }
 
+/**
+ * Set the state of all the LEDs in one step. The write is queued and applied by the table in its next tick.
+ * @param states New states of the LEDs (bit i: LED i)
+ */
+void set_leds(uint8_t states) {
+    queue_led_command(BIT_MASK(IO_NUM_LEDS), states);
+}
+
 /**
  * Validate the payload of an "A" command.
  * The payload must be a 4-character string containing only '0' and '1' characters.
@@ -213,10 +403,11 @@ bool validate_led_states(const char *payload) {
  */
 void send_inputs() {
     static char input_frame[] = "!Mi0000####";
-    input_frame[3] = '0' + rtdb.button0;
-    input_frame[4] = '0' + rtdb.button1;
-    input_frame[5] = '0' + rtdb.button2;
-    input_frame[6] = '0' + rtdb.button3;
+    RT_db *in = RT_db_in();
+    input_frame[3] = '0' + in->button0;
+    input_frame[4] = '0' + in->button1;
+    input_frame[5] = '0' + in->button2;
+    input_frame[6] = '0' + in->button3;
 
     // Update checksum
     int checksum = calculate_checksum(input_frame, strlen(input_frame) - 4);
@@ -224,7 +415,7 @@ void send_inputs() {
     input_frame[8] = '0' + ((checksum / 10) % 10); // Tens place
     input_frame[9] = '0' + (checksum % 10); // Units place
 
-    int err = uart_tx(uart, input_frame, strlen(input_frame), SYS_FOREVER_MS);
+    int err = uart_send(input_frame, strlen(input_frame));
     if (err) {
         printk("uart_tx() error. Error code:%d\n\r",err);
         return;
@@ -236,10 +427,11 @@ void send_inputs() {
  */
 void send_outputs() {
     static char output_frame[] = "!Me0000####";
-    output_frame[3] = '0' + rtdb.led0;
-    output_frame[4] = '0' + rtdb.led1;
-    output_frame[5] = '0' + rtdb.led2;
-    output_frame[6] = '0' + rtdb.led3;
+    RT_db *in = RT_db_in();
+    output_frame[3] = '0' + in->led0;
+    output_frame[4] = '0' + in->led1;
+    output_frame[5] = '0' + in->led2;
+    output_frame[6] = '0' + in->led3;
 
     // Update checksum
     int checksum = calculate_checksum(output_frame, strlen(output_frame) - 4);
@@ -247,12 +439,130 @@ void send_outputs() {
     output_frame[8] = '0' + ((checksum / 10) % 10); // Tens place
     output_frame[9] = '0' + (checksum % 10); // Units place
 
-    int err = uart_tx(uart, output_frame, strlen(output_frame), SYS_FOREVER_MS);
+    int err = uart_send(output_frame, strlen(output_frame));
+    if (err) {
+        printk("uart_tx() error. Error code:%d\n\r",err);
+        return;
+    }
+}
+
+
+/**
+ * Send the scheduler statistics over UART, every figure in fixed-width hexadecimal:
+ * !Ms<tasks:2><load:4><min slack:8><max release latency:8><release jitter:8>
+ *    then per task, in the order they were added: <activations:8><deferrals:8><overruns:8><max response:8>
+ *    <ticks:2> then per tick of the table of the first rate group, from the first: <slack:8>
+ *    <checksum>#
+ * The load is in per-mille and the times in microseconds. The slack of a tick is the least one over
+ * the CPUs; only the first STATS_MAX_TICKS ticks are sent, and none while the table is streamed.
+ * @param reset Clear the statistics once they are copied to the frame
+ */
+void send_stats(bool reset) {
+    static char stats_frame[TX_BUFFER_SIZE];
+    STBS_stats s;
+    STBS_task_stats t;
+    int num_tasks = MIN(STBS_GetNumTasks(), STATS_MAX_TASKS);
+    int num_ticks = STBS_GetTickSlack(0, 0) < 0 ? 0 : MIN(STBS_GetMacroCycle(), STATS_MAX_TICKS);
+
+    if (STBS_GetStats(&s) != 0) {
+        send_ack('4'); // Scheduler not started
+        return;
+    }
+    int length = snprintf(stats_frame, sizeof(stats_frame), "!Ms%02X%04X%08X%08X%08X", num_tasks,
+        MIN(s.load, 0xFFFFu), s.min_slack_us, s.max_release_latency_us, s.release_jitter_us);
+    for (int i = 0; i < num_tasks; i++) {
+        STBS_GetTaskStats(i, &t);
+        length += snprintf(&stats_frame[length], sizeof(stats_frame) - length, "%08X%08X%08X%08X",
+            t.activations, t.deferrals, t.overruns, t.max_response_us);
+    }
+    length += snprintf(&stats_frame[length], sizeof(stats_frame) - length, "%02X", num_ticks);
+    for (int tick = 0; tick < num_ticks; tick++) {
+        int slack = STBS_GetTickSlack(0, tick);
+        for (int cpu = 1; cpu < STBS_GetNumCpus(); cpu++) {
+            slack = MIN(slack, STBS_GetTickSlack(cpu, tick));
+        }
+        length += snprintf(&stats_frame[length], sizeof(stats_frame) - length, "%08X", MAX(slack, 0));
+    }
+    if (reset) {
+        STBS_ResetStats();
+    }
+
+    // Append the checksum
+    int checksum = calculate_checksum(stats_frame, length);
+    snprintf(&stats_frame[length], sizeof(stats_frame) - length, "%03d#", checksum);
+    length += 4;
+
+    int err = uart_send(stats_frame, length);
     if (err) {
         printk("uart_tx() error. Error code:%d\n\r",err);
+    }
+}
+
+/**
+ * Send the newest events of the fault log over UART, every figure in fixed-width hexadecimal:
+ * !Mf<events in the log:8><events sent:2>
+ *    then per event, oldest first: <uptime ms:8><boot:4><event:2><source:2><value:8>
+ *    <checksum>#
+ */
+void send_faults(void) {
+    static char fault_frame[4 + 10 + 24 * FAULT_FRAME_MAX_EVENTS + 5];
+    fault_log_entry events[FAULT_FRAME_MAX_EVENTS];
+    uint32_t total;
+
+    fault_log_flush();      // include the events still queued
+    int count = fault_log_read(events, FAULT_FRAME_MAX_EVENTS, &total);
+    if (count < 0) {
+        send_ack('4'); // Log not available
         return;
     }
+    int length = snprintf(fault_frame, sizeof(fault_frame), "!Mf%08X%02X", total, count);
+    for (int i = 0; i < count; i++) {
+        length += snprintf(&fault_frame[length], sizeof(fault_frame) - length, "%08X%04X%02X%02X%08X",
+            events[i].uptime_ms, events[i].boot, events[i].event, events[i].source, (uint32_t)events[i].value);
+    }
+
+    // Append the checksum
+    int checksum = calculate_checksum(fault_frame, length);
+    snprintf(&fault_frame[length], sizeof(fault_frame) - length, "%03d#", checksum);
+    length += 4;
+
+    int err = uart_send(fault_frame, length);
+    if (err) {
+        printk("uart_tx() error. Error code:%d\n\r",err);
+    }
+}
+
+#ifdef CONFIG_STBS_FAULT_INJECT
+/**
+ * Send the fault injection statistics over UART, every figure in fixed-width hexadecimal:
+ * !Mx then per fault kind (enum fault_inject_kind): <rate:4><injected:8><detected:8><masked:8><recovered:8>
+ *    <max detection ticks:4><max recovery ticks:4>
+ *    <checksum>#
+ * The detection and recovery latencies in us are read with the L frame.
+ */
+void send_fault_injection(void) {
+    static char inject_frame[3 + 44 * FAULT_INJECT_NUM_KINDS + 5];
+    fault_inject_stats s;
+
+    int length = snprintf(inject_frame, sizeof(inject_frame), "!Mx");
+    for (int kind = 0; kind < FAULT_INJECT_NUM_KINDS; kind++) {
+        fault_inject_get_stats(kind, &s);
+        length += snprintf(&inject_frame[length], sizeof(inject_frame) - length, "%04X%08X%08X%08X%08X%04X%04X",
+            fault_inject_get_rate(kind), s.injected, s.detected, s.masked, s.recovered,
+            MIN(s.max_detection_ticks, 0xFFFFu), MIN(s.max_recovery_ticks, 0xFFFFu));
+    }
+
+    // Append the checksum
+    int checksum = calculate_checksum(inject_frame, length);
+    snprintf(&inject_frame[length], sizeof(inject_frame) - length, "%03d#", checksum);
+    length += 4;
+
+    int err = uart_send(inject_frame, length);
+    if (err) {
+        printk("uart_tx() error. Error code:%d\n\r",err);
+    }
 }
+#endif
 
 
 /************************** UART ******************************/
@@ -266,12 +576,14 @@ static int buffer_idx = 0;
 static void uart_cb(const struct device *dev, struct uart_event *evt, void *user_data) {
     static char frame_buffer[INPUT_BUFFER_SIZE] = {0}; // Frame buffer
     static int frame_idx = 0;
+    static uint32_t rx_start;       // cycle count of the first byte of the frame being received
 
     switch (evt->type) {
     case UART_RX_RDY:
         for (size_t i = 0; i < evt->data.rx.len; i++) {
             char received_char = evt->data.rx.buf[evt->data.rx.offset + i];
             if (frame_idx == 0 && received_char == '!') { // Start of frame
+                rx_start = k_cycle_get_32();
                 memset(frame_buffer, 0, INPUT_BUFFER_SIZE);
                 frame_buffer[frame_idx++] = received_char;
                 printk("%c", received_char);
@@ -284,7 +596,12 @@ static void uart_cb(const struct device *dev, struct uart_event *evt, void *user
                     // put the checksum in the buffer before the '#'
                     // int checksum = calculate_checksum(frame_buffer, frame_idx - 1);
 
-                    process_frame(frame_buffer, frame_idx); // Process the frame
+                    // processed by the protocol task, in the time the scheduler leaves idle
+                    rx_frame frame = {.length = frame_idx, .start = rx_start};
+                    memcpy(frame.data, frame_buffer, sizeof(frame.data));
+                    if (k_msgq_put(&frame_queue, &frame, K_NO_WAIT) != 0) {
+                        printk("Frame dropped: protocol task busy\n");
+                    }
                     frame_idx = 0;
                 }
             }
@@ -295,6 +612,11 @@ static void uart_cb(const struct device *dev, struct uart_event *evt, void *user
         uart_rx_enable(dev, rx_buf, sizeof(rx_buf), RECEIVE_TIMEOUT);
         break;
 
+    case UART_TX_DONE:
+    case UART_TX_ABORTED:
+        k_sem_give(&tx_done);   // the next reply can be sent
+        break;
+
     default:
         break;
     }
@@ -308,125 +630,220 @@ static void uart_cb(const struct device *dev, struct uart_event *evt, void *user
 /************************** THREADS ******************************/
 
 // Configuration constants
-#define TICK_MS 50          // Scheduler tick period in milliseconds
+#define TICK_US 50000       // Scheduler tick period in microseconds
 #define MAX_TASKS 15
+#define LET_MODE 0          // 1: latch inputs/commit outputs at the tick boundaries (logical execution time)
+#define JOB_MODE 1          // 1: jobs 0-2 run to completion on the dispatcher, 0: one thread each
 
-extern const k_tid_t thread0,thread1,thread2,thread3;
+extern const k_tid_t thread0,thread1,thread2,protocol_thread;
+
+/**
+ * Records the button-to-LED latency of the presses whose LED toggle was just written.
+ */
+static void record_led_latencies(void) {
+    atomic_val_t pending = atomic_clear(&led_press_pending);
+
+    for (int i = 0; i < IO_NUM_LEDS; i++) {
+        if (pending & BIT(i)) {
+            latency_record(LATENCY_BUTTON_TO_LED, led_press[i]);
+        }
+    }
+}
 
 
 /**
- * Task 0: Periodic task with period 1 tick
- * this task is responsible for updating the RTDB with the button states
+ * Job 0: Periodic job with period 1 tick
+ * this job is responsible for writing the LED states from the RTDB to the outputs
+ * (the buttons are captured by interrupt, see job1)
  */
-void task0(void *argA, void *argB, void *argC) {
-    // k_tid_t task_id = *(k_tid_t *)id_ptr; // Retrieve task ID
-    while (1) {
-        
-        k_thread_suspend(thread0);
-        int timer1 = k_uptime_get();
-        // printk("T0->timer1: %d\n",timer1);
-        gpio_pin_set_dt(&led0,rtdb.led0);
-        gpio_pin_set_dt(&led1,rtdb.led1);
-        gpio_pin_set_dt(&led2,rtdb.led2);
-        gpio_pin_set_dt(&led3,rtdb.led3);
-
-        rtdb.button0 = gpio_pin_get_dt(&button0); // Read button0 state
-        rtdb.button1 = gpio_pin_get_dt(&button1); // Read button1 state
-        rtdb.button2 = gpio_pin_get_dt(&button2); // Read button2 state
-        rtdb.button3 = gpio_pin_get_dt(&button3); // Read button3 state
-    
-        int timer2 = k_uptime_get();
-        // printk("T0->timer2: %d\n",timer2);
-        // printk("Task0 execution time: %d\n",timer2-timer1);
-        // RT_db_print(&rtdb);
-        // gpio_pin_set_dt(&led3,rtdb.led3);
-        // printk("Task0 executing %d\n",thread0); // Simulate task behavior
+void job0(void *arg) {
+    int timer1 = k_uptime_get();
+    fault_inject_exec();
+    // printk("T0->timer1: %d\n",timer1);
+    if (!RT_db_let_enabled()) {
+        // in LET mode the outputs are committed at the tick boundary instead
+        apply_led_commands(RT_db_out());
+        io_write_leds(RT_db_get_leds(RT_db_in()));    // Write all LEDs (one masked write per port)
+        record_led_latencies();
     }
+
+    int timer2 = k_uptime_get();
+    // printk("T0->timer2: %d\n",timer2);
+    // printk("Task0 execution time: %d\n",timer2-timer1);
+    // RT_db_print(&rtdb);
+    // gpio_pin_set_dt(&led3,rtdb.led3);
+    // printk("Task0 executing %d\n",thread0); // Simulate task behavior
 }
 
 
 /**
- * Task 1: Periodic task with period 2 ticks
- * this task is responsible for updating the led states based on the button states from the RTDB
+ * Job 1: Periodic job with period 2 ticks
+ * this job consumes the debounced button edges queued by the GPIO interrupt,
+ * updating the button states in the RTDB and toggling a LED on every press
  */
-void task1(void *argA, void *argB, void *argC) {
-    // k_tid_t task_id = *(k_tid_t *)id_ptr; // Retrieve task ID
-    static int prev_button0 = 0;
-    static int prev_button1 = 0;
-    static int prev_button2 = 0;
-    static int prev_button3 = 0;
-    while (1) {
-        k_thread_suspend(thread1);
-        int timer1 = k_uptime_get();
-        // printk("T1->timer1: %d\n",timer1);
-        // based on the button state,change the led state once
-        if(rtdb.button0 == 1 && prev_button0 == 0){
-            rtdb.led0 = !rtdb.led0;
-        }
-        if(rtdb.button1 == 1 && prev_button1 == 0){
-            rtdb.led1 = !rtdb.led1;
-        }
-        if(rtdb.button2 == 1 && prev_button2 == 0){
-            rtdb.led2 = !rtdb.led2;
-        }
-        if(rtdb.button3 == 1 && prev_button3 == 0){
-            rtdb.led3 = !rtdb.led3;
+void job1(void *arg) {
+    button_event evt;
+    int timer1 = k_uptime_get();
+    fault_inject_exec();
+    // printk("T1->timer1: %d\n",timer1);
+    RT_db *out = RT_db_out();
+    // in LET mode only the edges latched at the tick boundaries belong to this tick
+    bool let = RT_db_let_enabled();
+
+    // every edge is queued, so presses shorter than the task period are not lost
+    while ((let ? k_msgq_get(&let_events, &evt, K_NO_WAIT)
+                : io_get_button_event_until(&evt, k_cycle_get_32())) == 0) {
+        RT_db_set_button(out, evt.button, evt.level);
+        if (evt.level == 1) {
+            RT_db_toggle_led(out, evt.button);
+            // the latency is measured from the first press not written to the LED yet
+            if (!atomic_test_bit(&led_press_pending, evt.button)) {
+                led_press[evt.button] = evt.timestamp;
+                atomic_set_bit(&led_press_pending, evt.button);
+            }
         }
+    }
 
-        prev_button0 = rtdb.button0;
-        prev_button1 = rtdb.button1;
-        prev_button2 = rtdb.button2;
-        prev_button3 = rtdb.button3;
+    int timer2 = k_uptime_get();
+    // printk("T1->timer2: %d\n",timer2);
+    // printk("Task1 execution time: %d\n",timer2-timer1);
 
-        int timer2 = k_uptime_get();
-        // printk("T1->timer2: %d\n",timer2);
-        // printk("Task1 execution time: %d\n",timer2-timer1);
+    // k_msleep(TICK_MS); // Simulate work
+}
 
-        // k_msleep(TICK_MS); // Simulate work
+/**
+ * Resets an RTDB value that is neither 0 nor 1, and logs it in the fault log.
+ * @param in_value Value read
+ * @param out_value Where the value is written back
+ * @param field Field of the value (enum rtdb_field)
+ */
+static void validate_rtdb_value(int in_value, int *out_value, int field) {
+    if (in_value != 0 && in_value != 1) {
+        *out_value = 0;
+        printk("corrupted data\n");
+        fault_log_record(FAULT_LOG_CORRUPTED, field, in_value);
+        fault_inject_detected(FAULT_INJECT_RTDB);
     }
 }
 
 // Validate rtdb entries and reset them if they are corrupted
-void task2(void *argA, void *argB, void *argC) {
-    // k_tid_t task_id = *(k_tid_t *)id_ptr; // Retrieve task ID
-    while (1) {
-        k_thread_suspend(thread2);
-
-        int timer1 = k_uptime_get();
-        // printk("T2->timer1: %d\n",timer1);
-        if(rtdb.button0 != 0 && rtdb.button0 != 1) {rtdb.button0 = 0; printk("corrupted data\n");}
-        if(rtdb.button1 != 0 && rtdb.button1 != 1) {rtdb.button1 = 0; printk("corrupted data\n");}
-        if(rtdb.button2 != 0 && rtdb.button2 != 1) {rtdb.button2 = 0; printk("corrupted data\n");}
-        if(rtdb.button3 != 0 && rtdb.button3 != 1) {rtdb.button3 = 0; printk("corrupted data\n");}
-
-        if(rtdb.led0 != 0 && rtdb.led0 != 1) {rtdb.led0 = 0; printk("corrupted data\n");}
-        if(rtdb.led1 != 0 && rtdb.led1 != 1) {rtdb.led1 = 0; printk("corrupted data\n");}
-        if(rtdb.led2 != 0 && rtdb.led2 != 1) {rtdb.led2 = 0; printk("corrupted data\n");}
-        if(rtdb.led3 != 0 && rtdb.led3 != 1) {rtdb.led3 = 0; printk("corrupted data\n");}
-        int timer2 = k_uptime_get();
-        // printk("T2->timer1: %d\n",timer2);
-        // printk("Task2 execution time: %d\n",timer2-timer1);
-
-        // k_msleep(TICK_MS); // Simulate work
+void job2(void *arg) {
+    int timer1 = k_uptime_get();
+    fault_inject_exec();
+    // printk("T2->timer1: %d\n",timer1);
+    RT_db *in = RT_db_in();
+    RT_db *out = RT_db_out();
+    for (int field = 0; field < RTDB_NUM_FIELDS; field++) {
+        validate_rtdb_value(*RT_db_field(in, field), RT_db_field(out, field), field);
     }
+    int timer2 = k_uptime_get();
+    // printk("T2->timer1: %d\n",timer2);
+    // printk("Task2 execution time: %d\n",timer2-timer1);
+
+    // k_msleep(TICK_MS); // Simulate work
 }
 
-void task3(void *argA, void *argB, void *argC) {
-    // k_tid_t task_id = *(k_tid_t *)id_ptr; // Retrieve task ID
+/**
+ * Protocol task: processes the frames received over UART. It runs in the background
+ * lane of the scheduler, so the frames never delay the releases of the table.
+ */
+void protocol_task(void *argA, void *argB, void *argC) {
+    rx_frame frame;
+
     while (1) {
-        k_thread_suspend(thread3);
-        //printk("Task3 executing %d\n",thread3); // Simulate task behavior
-        // k_msleep(TICK_MS); // Simulate work
+        k_msgq_get(&frame_queue, &frame, K_FOREVER);
+        frame_start = frame.start;
+        int corrupted = fault_inject_frame(frame.data, frame.length);
+        last_ack = 0;
+        process_frame(frame.data, frame.length);
+        if (corrupted) {
+            fault_inject_frame_checked(last_ack != 0 && last_ack != '1');
+        }
     }
 }
 
 /*
  * defining threads
 */
-K_THREAD_DEFINE(thread0 , 512, task0, NULL, NULL, NULL,5,0,0);
-K_THREAD_DEFINE(thread1, 512, task1, NULL, NULL, NULL,5,0,0);
-K_THREAD_DEFINE(thread2, 512, task2, NULL, NULL, NULL,1,0,0);
-K_THREAD_DEFINE(thread3, 512, task3, NULL, NULL, NULL,5,0,0);
+#if JOB_MODE
+#define TASK0 STBS_JOB_ID(job0)
+#define TASK1 STBS_JOB_ID(job1)
+#define TASK2 STBS_JOB_ID(job2)
+#else
+/**
+ * Runs a job in its own thread, once per release.
+ * @param job Job function
+ */
+void job_thread(void *job, void *argB, void *argC) {
+    while (1) {
+        STBS_WaitRelease();
+        ((STBS_job)job)(NULL);
+    }
+}
+
+K_THREAD_DEFINE(thread0 , 512, job_thread, (void *)job0, NULL, NULL,5,0,0);
+K_THREAD_DEFINE(thread1, 512, job_thread, (void *)job1, NULL, NULL,5,0,0);
+K_THREAD_DEFINE(thread2, 512, job_thread, (void *)job2, NULL, NULL,5,0,0);
+#define TASK0 thread0
+#define TASK1 thread1
+#define TASK2 thread2
+#endif
+K_THREAD_DEFINE(protocol_thread, 1024, protocol_task, NULL, NULL, NULL, STBS_BACKGROUND_PRIORITY(0), 0, 0);
+
+/**
+ * Logs the faults detected by the scheduler in the fault log; the timing faults also
+ * detect the injected ones.
+ */
+static void log_scheduler_fault(int fault, int task, int value) {
+    switch (fault) {
+    case STBS_FAULT_OVERRUN:
+        fault_log_record(FAULT_LOG_OVERRUN, task, value);
+        fault_inject_timing_fault();
+        break;
+    case STBS_FAULT_LATE_RELEASE:
+        fault_log_record(FAULT_LOG_LATE_RELEASE, task, value);
+        fault_inject_timing_fault();
+        break;
+    case STBS_FAULT_MISSED_TICK:
+        fault_log_record(FAULT_LOG_MISSED_TICK, task, value);
+        fault_inject_timing_fault();
+        break;
+    default:
+        fault_log_record(FAULT_LOG_NOT_SCHEDULABLE, task, value);
+        break;
+    }
+}
+
+/**
+ * Tick boundary in LET mode: publishes what the tasks and the frames wrote during the previous tick,
+ * commits all the outputs in one batched write and latches the inputs of the new tick.
+ */
+static void let_tick_boundary(int tick) {
+    button_event evt;
+
+    // the LED writes of the frames are published with the rest of the tick
+    apply_led_commands(RT_db_out());
+    RT_db *in = RT_db_let_swap();
+    io_write_leds(RT_db_get_leds(in));
+    record_led_latencies();
+
+    // the buttons the tasks read during the tick are the levels of the edges up to here;
+    // the edges are kept for job1, the later ones stay queued for the next boundary
+    while (k_msgq_num_free_get(&let_events) > 0 && io_get_button_event(&evt) == 0) {
+        RT_db_let_latch_button(evt.button, evt.level);
+        k_msgq_put(&let_events, &evt, K_NO_WAIT);
+    }
+}
+
+/**
+ * Tick hook: the LET boundary, then the faults injected at the start of the tick.
+ */
+static void tick_boundary(int tick) {
+    if (LET_MODE) {
+        let_tick_boundary(tick);
+    }
+    fault_inject_tick();
+}
 
 /**
  * Main function demonstrating the Static Table-Based Scheduler (STBS).
@@ -442,50 +859,16 @@ int main(void) {
 		printk("UART device not ready\r\n");
 		return 1 ;
 	}
-	/* Verify that the LED devices are ready */
-	if (!device_is_ready(led0.port)){
-		printk("GPIO device is not ready\r\n");
-		return 1;
-	}
-	/* Configure the GPIOs of the LEDs */
-	ret = gpio_pin_configure_dt(&led0, GPIO_OUTPUT_ACTIVE);
+	/* Configure the GPIOs of the LEDs and buttons */
+	ret = io_init();
 	if (ret < 0) {
-		return 1 ; 
-	}
-	ret = gpio_pin_configure_dt(&led1, GPIO_OUTPUT_ACTIVE);
-	if (ret < 0) {
-		return 1 ;
+		return 1;
 	}
-	ret = gpio_pin_configure_dt(&led2, GPIO_OUTPUT_ACTIVE);
+	/* Capture the button edges by interrupt */
+	ret = io_buttons_irq_init(IO_DEBOUNCE_US);
 	if (ret < 0) {
-		return 1 ;
+		return 1;
 	}
-    ret = gpio_pin_configure_dt(&led3, GPIO_OUTPUT_ACTIVE);
-    if (ret < 0) {
-        return 1 ;
-    }
-
-    /* Configure the GPIOs of the buttons */
-    ret = gpio_pin_configure_dt(&button0, GPIO_INPUT);
-    if (ret < 0) {
-        return 1 ;
-    }
-
-    ret = gpio_pin_configure_dt(&button1, GPIO_INPUT);
-    if (ret < 0) {
-        return 1 ;
-    }
-
-    ret = gpio_pin_configure_dt(&button2, GPIO_INPUT);
-    if (ret < 0) {
-        return 1 ;
-    }
-
-    ret = gpio_pin_configure_dt(&button3, GPIO_INPUT);
-    if (ret < 0) {
-        return 1 ;
-    }
-
 
 	/* Register the UART callback function */
 	ret = uart_callback_set(uart, uart_cb, NULL);
@@ -505,29 +888,54 @@ int main(void) {
 
 
     RT_db_init(&rtdb);
+    RT_db_let_init(&rtdb, LET_MODE);
+
+    // Keeps the faults across resets (in RAM only without a fault_log_partition)
+    fault_log_init();
 
 
 
     // Initialize the scheduler
-    STBS_Init(TICK_MS,MAX_TASKS);
+    STBS_Init(TICK_US,MAX_TASKS);
+    STBS_SetFaultHook(log_scheduler_fault);
+    STBS_SetTickHook(tick_boundary);
 
     // Add tasks with different periods
     // STBS_AddTask(1, thread0, 1,40,"thread0"); // Task 1: Period = 1 ticks
     // STBS_AddTask(3, thread2, 1,120,"thread2"); // Task 3: Period = 3 ticks
     // STBS_AddTask(2, thread1, 1,160,"thread1"); // Task 2: Period = 2 tick
-    // STBS_AddTask(2, thread3, 1,40,"thread3"); // Task 2: Period = 2 tick
 
-    STBS_AddTask(1, thread0, 1,3,"thread0"); // Task 1: Period = 1 ticks
-    STBS_AddTask(2, thread1, 2,3,"thread1"); // Task 2: Period = 2 tick
-    STBS_AddTask(2, thread2, 1,3,"thread2"); // Task 3: Period = 3 ticks
+#if JOB_MODE
+    STBS_AddJob(1, job0, NULL, 1,3000,"job0"); // Job 1: Period = 1 ticks
+    STBS_AddJob(2, job1, NULL, 2,3000,"job1"); // Job 2: Period = 2 tick
+    STBS_AddJob(2, job2, NULL, 1,3000,"job2"); // Job 3: Period = 2 ticks
+#else
+    STBS_AddTask(1, thread0, 1,3000,"thread0"); // Task 1: Period = 1 ticks
+    STBS_AddTask(2, thread1, 2,3000,"thread1"); // Task 2: Period = 2 tick
+    STBS_AddTask(2, thread2, 1,3000,"thread2"); // Task 3: Period = 3 ticks
+#endif
+
+    // Frames are processed in the time the table leaves idle
+    STBS_AddBackground(protocol_thread, 0, "protocol");
+    STBS_AddBackground(fault_log_writer, STBS_BACKGROUND_LEVELS - 1, "fault_log");
+
+    // Data flow: job1 turns button edges into LED states, job2 validates them, job0 writes the LEDs
+    STBS_AddPrecedence(TASK1, TASK2, 0);    // validated in the same tick
+    STBS_AddPrecedence(TASK2, TASK0, 1);    // job0 runs every tick, job2 every other one
 
     // STBS_AddTask(1, thread0, 10,40,"thread0"); // Task 1: Period = 1 ticks
     // STBS_AddTask(3, thread2, 5,50,"thread2"); // Task 3: Period = 3 ticks
     // STBS_AddTask(2, thread1, 7,60,"thread1"); // Task 2: Period = 2 tick
-    // STBS_AddTask(2, thread3, 2,30,"thread3"); // Task 2: Period = 2 tick
 
     // STBS_print_content();
-    // Start the scheduler
-    STBS_Start();
+    // Start the scheduler (the tasks are released by the dispatcher thread, main is free from here on)
+    ret = STBS_Start();
+    if (ret) {
+        printk("STBS failed to start: %d\n", ret);
+        return 1;
+    }
+
+    k_tid_t button_to_led[] = {TASK1, TASK2, TASK0};
+    printk("Button-to-LED chain latency: %d us\n", STBS_GetChainLatency(button_to_led, ARRAY_SIZE(button_to_led)));
     return 0;
 }
\ No newline at end of file
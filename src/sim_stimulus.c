@@ -0,0 +1,76 @@
+/**
+ * @file
+ * @brief Button stimulus driver for the native_sim build
+ *
+ * Presses the buttons of the emulated GPIO controller following a repeatable
+ * pseudo-random pattern, including contact bounce and presses shorter than the
+ * scheduler tick. Frames are sent from the host through the uart0 pseudo-terminal
+ * (see scripts/stbs_host.py).
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/drivers/gpio/gpio_emul.h>
+
+#include "../include/io.h"
+
+#define SIM_START_DELAY_MS 1000     // let the scheduler start before the first press
+#define SIM_PRESS_PERIOD_MS 300     // time between two presses
+#define SIM_MIN_HOLD_MS 5           // shortest press (shorter than a tick)
+#define SIM_MAX_HOLD_MS 150         // longest press
+#define SIM_BOUNCE_EDGES 4          // extra edges generated on every press and release
+#define SIM_BOUNCE_US 300           // time between two bounce edges
+#define SIM_SEED 0x5754B5u          // fixed seed so every run sees the same pattern
+
+static const struct gpio_dt_spec sim_buttons[IO_NUM_BUTTONS] = {
+    GPIO_DT_SPEC_GET(DT_ALIAS(sw0), gpios),
+    GPIO_DT_SPEC_GET(DT_ALIAS(sw1), gpios),
+    GPIO_DT_SPEC_GET(DT_ALIAS(sw2), gpios),
+    GPIO_DT_SPEC_GET(DT_ALIAS(sw3), gpios),
+};
+
+static uint32_t sim_rand_state = SIM_SEED;
+
+static uint32_t sim_rand(void) {
+    // xorshift32: cheap and reproducible across hosts
+    sim_rand_state ^= sim_rand_state << 13;
+    sim_rand_state ^= sim_rand_state >> 17;
+    sim_rand_state ^= sim_rand_state << 5;
+    return sim_rand_state;
+}
+
+/**
+ * @brief Drives a button to a level, bouncing before settling.
+ */
+static void sim_set_button(const struct gpio_dt_spec *button, int level) {
+    for (int i = 0; i < SIM_BOUNCE_EDGES; i++) {
+        gpio_emul_input_set(button->port, button->pin, (i % 2) ? !level : level);
+        k_busy_wait(SIM_BOUNCE_US);
+    }
+    gpio_emul_input_set(button->port, button->pin, level);
+}
+
+static void sim_stimulus(void *argA, void *argB, void *argC) {
+    uint32_t presses = 0;
+
+    k_msleep(SIM_START_DELAY_MS);
+    while (1) {
+        int button = sim_rand() % IO_NUM_BUTTONS;
+        int hold_ms = SIM_MIN_HOLD_MS + sim_rand() % (SIM_MAX_HOLD_MS - SIM_MIN_HOLD_MS + 1);
+
+        sim_set_button(&sim_buttons[button], 1);
+        k_msleep(hold_ms);
+        sim_set_button(&sim_buttons[button], 0);
+
+        presses++;
+        if (presses % 10 == 0) {
+            printk("SIM: %u button presses generated\n", presses);
+        }
+        k_msleep(SIM_PRESS_PERIOD_MS);
+    }
+}
+
+// lowest application priority, so the stimulus never delays the table tasks
+K_THREAD_DEFINE(sim_stimulus_thread, 1024, sim_stimulus, NULL, NULL, NULL, K_LOWEST_APPLICATION_THREAD_PRIO, 0, 0);
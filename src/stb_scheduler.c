@@ -3,36 +3,290 @@
 #include "../include/functions.h"
 
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
 
 static STB_scheduler stbs; // Global scheduler instance
-static scheduler_table_entry *entry;
+static scheduler_table_entry *entry[STBS_MAX_GROUPS][STBS_MAX_CPUS];     // one table per group and CPU
+static STBS_tick_hook tick_hook = NULL;
+static STBS_fault_hook fault_hook = NULL;
+static STBS_precedence precedences[STBS_MAX_PRECEDENCES];
+static int num_precedences = 0;
+
+// Background lane: tasks outside the table, run in the time it leaves idle (see STBS_AddBackground())
+typedef struct {
+    k_tid_t id;
+    int level;
+    char *name;
+#ifdef CONFIG_SCHED_THREAD_USAGE_ALL
+    uint64_t usage_base;    // execution cycles of the task when the statistics were reset
+#endif
+} STBS_background;
+
+static STBS_background background[STBS_MAX_BACKGROUND];
+static int num_background = 0;
+
+// Dispatchers (one per group and CPU), the ones of a group all woken by the same tick timer
+static struct k_timer tick_timer[STBS_MAX_GROUPS];
+static struct k_thread dispatcher_thread[STBS_MAX_GROUPS][STBS_MAX_CPUS];
+static K_THREAD_STACK_ARRAY_DEFINE(dispatcher_stack, STBS_MAX_GROUPS * STBS_MAX_CPUS, STBS_DISPATCHER_STACK_SIZE);
+static struct k_sem tick_sem[STBS_MAX_GROUPS][STBS_MAX_CPUS];
+static volatile int current_tick[STBS_MAX_GROUPS];     // position in the table of each group, shared by all the CPUs
+static volatile int stbs_running = 0;
+
+// Streaming tables (see STBS_SetWindow()): a ring of window ticks per group and CPU, filled ahead of the dispatchers
+static uint32_t *window_seq[STBS_MAX_GROUPS];              // tick sequence number each slot of the ring holds
+static volatile uint32_t release_seq[STBS_MAX_GROUPS];     // sequence number of the tick being released
+static uint32_t filled_seq[STBS_MAX_GROUPS];               // sequence number of the next tick to fill
+static int fill_tick[STBS_MAX_GROUPS];                     // position in the macro-cycle of the next tick to fill
+static uint32_t held_seq[STBS_MAX_GROUPS][STBS_MAX_CPUS];  // oldest tick each dispatcher may still read from the ring
+static struct k_spinlock window_lock;                      // the filler and the late dispatchers fill the rings
+static struct k_thread filler_thread;
+static K_THREAD_STACK_DEFINE(filler_stack, STBS_FILLER_STACK_SIZE);
+static struct k_sem filler_sem;
+
+// Dispatcher overheads, counted in the table on top of the execution times (see STBS_Calibrate())
+static STBS_overhead overhead;
+static int overhead_set = 0;
+static struct k_thread calibration_thread;
+static struct k_sem calibration_sem;
+
+// Run-time statistics of a task, and the state of its last job
+typedef struct {
+    k_tid_t id;
+    int cpu;
+    int group;
+    STBS_task_stats stats;
+    uint32_t release;       // cycle count of the release of the last job
+    int pending;            // the last job has not ended yet
+} STBS_task_runtime;
+
+static STBS_task_runtime *runtime;                  // per task, in the order they were added
+static int init_error = 0;                          // -ENOMEM if STBS_Init() could not allocate the task table
+static struct k_spinlock stats_lock;                // statistics are updated by the dispatchers and the tasks
+static STBS_stats stats;
+static uint32_t min_release_latency_us;
+static volatile uint32_t tick_expiry;               // cycle count of the last tick timer expiry of group 0
+static uint32_t cpu_tick_start[STBS_MAX_CPUS];      // release of the current tick of each CPU
+static uint32_t cpu_last_end[STBS_MAX_CPUS];        // end of the last job of each CPU
+static int cpu_released[STBS_MAX_CPUS];             // jobs released in the current tick of each CPU
+static int cpu_pending[STBS_MAX_CPUS];              // jobs of each CPU that have not ended yet
+#ifdef CONFIG_SCHED_THREAD_USAGE_ALL
+static k_thread_runtime_stats_t usage_base;         // CPU usage when the statistics were reset
+#endif
+
+static void STBS_FreeTable(void);
+static int STBS_FindTask(k_tid_t id);
+static int STBS_GroupCapacity(int group, int cpu, const int *cpus);
+static void STBS_StatsTick(int cpu, uint32_t now);
 
 /**
  * @brief Initializes the STB scheduler.
- * @param tick_ms Tick duration in milliseconds.
+ * If the task table cannot be allocated, no task can be added and STBS_BuildTable() returns -ENOMEM.
+ * @param tick_us Tick duration in microseconds.
  * @param max_tasks Maximum number of tasks that can be scheduled.
  */
-void STBS_Init(int tick_ms, int max_tasks) {
-    stbs.tick_ms = tick_ms;
+void STBS_Init(int tick_us, int max_tasks) {
+    if (stbs.task_table) {
+        STBS_destroy();     // re-initialization: drop the previous tasks
+    }
+    memset(stbs.groups, 0, sizeof(stbs.groups));
+    stbs.groups[0].tick_us = tick_us;
+    stbs.num_groups = 1;
     stbs.max_tasks = max_tasks;
     stbs.num_tasks = 0;
+    stbs.num_cpus = MIN(arch_num_cpus(), STBS_MAX_CPUS);
+    stbs.window = 0;
+    num_precedences = 0;
+    num_background = 0;
     stbs.task_table = k_malloc(max_tasks * sizeof(Task));
+    runtime = k_malloc(max_tasks * sizeof(STBS_task_runtime));
+    if (!stbs.task_table || !runtime) {
+        printk("Failed to allocate the task table\n");
+        k_free(stbs.task_table);
+        k_free(runtime);
+        stbs.task_table = NULL;
+        runtime = NULL;
+        stbs.max_tasks = 0;
+        init_error = -ENOMEM;
+        return;
+    }
+    init_error = 0;
+    memset(runtime, 0, max_tasks * sizeof(STBS_task_runtime));
     // Initialize task table
     for (int i = 0; i < max_tasks; i++) {
         stbs.task_table[i].id = -1; // Mark as unused
         stbs.task_table[i].ticks = 0;
         stbs.task_table[i].next_activation = -1;
     }
+    // once: the overheads do not depend on the tasks
+    if (!overhead_set && STBS_Calibrate() == -EPERM) {
+        printk("STBS overhead not measured: STBS_Init() called from a thread that cannot be preempted\n");
+    }
 
     printk("STBS Initialized\n");
 }
 
+/**
+ * @brief Sets the number of CPUs the tasks are partitioned on.
+ * By default all the CPUs of the system are used (one with CONFIG_SMP disabled).
+ * @param num_cpus Number of CPUs, from 1 to STBS_MAX_CPUS.
+ * @return 0 on success, -EINVAL if the number is out of range, -EBUSY if the scheduler is running.
+ */
+int STBS_SetNumCpus(int num_cpus) {
+    if (num_cpus < 1 || num_cpus > STBS_MAX_CPUS) {
+        return -EINVAL;
+    }
+    if (stbs_running) {
+        return -EBUSY;
+    }
+    STBS_FreeTable();
+    stbs.num_cpus = num_cpus;
+    return 0;
+}
+
+/**
+ * @brief Keeps only a window of the upcoming ticks of every table in memory, instead of the
+ * whole macro-cycle, so the memory of the tables does not grow with the hyperperiod.
+ * The window is a ring that a background thread (see STBS_FILLER_PRIORITY) fills ahead of the
+ * dispatchers, tick by tick, from the release state of the tasks (Task.next_activation), so the
+ * ticks are the same as in the whole table; if the filler falls behind, the dispatcher fills
+ * its tick itself. The whole macro-cycle is still run once, without storing it, when the table
+ * is built. Precedences and jitter bounds need the whole table, so they are not supported.
+ * @param ticks Ticks of the window, a power of two of at least 2, or 0 to build the whole macro-cycle.
+ * @return 0 on success, -EINVAL if the window is invalid, -EBUSY if the scheduler is running.
+ */
+int STBS_SetWindow(int ticks) {
+    if (ticks < 0 || ticks == 1 || (ticks & (ticks - 1)) != 0) {
+        return -EINVAL;     // a power of two keeps the ring position continuous when the sequence number wraps
+    }
+    if (stbs_running) {
+        return -EBUSY;
+    }
+    STBS_FreeTable();
+    stbs.window = ticks;
+    return 0;
+}
+
+// Calibration thread: wakes up as a dispatcher does every tick, then suspends as a released task does
+static void STBS_CalibrationTask(void *argA, void *argB, void *argC) {
+    while (1) {
+        k_sem_take(&calibration_sem, K_FOREVER);
+        STBS_StatsTick(0, k_cycle_get_32());
+        k_thread_suspend(k_current_get());
+    }
+}
+
+/**
+ * @brief Measures the dispatcher overheads on the running hardware. The schedulability check
+ * and the table count them on top of the execution times of the tasks:
+ *  - per tick: waking up the dispatcher, updating the statistics and switching out when it waits again;
+ *  - per release: resuming a task (or calling a job), switching into it and out when it suspends.
+ * A thread above the caller is woken up and resumed STBS_CALIBRATION_RUNS times, and the
+ * longest round trip of each kind is kept. The caller must be preempted by it, so it must be
+ * a preemptible thread (not a cooperative one) below STBS_DISPATCHER_PRIORITY. STBS_Init()
+ * calls it the first time; from any other thread the overheads are left as they are, and can
+ * be set with STBS_SetOverhead(). The thread runs on the stack of the window filler, which is
+ * idle while the scheduler is stopped.
+ * @return 0 on success, -EBUSY if the scheduler is running, -EPERM if the caller cannot be preempted.
+ */
+int STBS_Calibrate(void) {
+    uint32_t tick_cycles = 0, release_cycles = 0;
+
+    if (stbs_running) {
+        return -EBUSY;
+    }
+    if (!k_is_preempt_thread() || k_thread_priority_get(k_current_get()) <= STBS_DISPATCHER_PRIORITY) {
+        return -EPERM;      // the round trips would never switch to the thread, and measure nothing
+    }
+    k_sem_init(&calibration_sem, 0, 1);
+    k_thread_create(&calibration_thread, filler_stack, K_THREAD_STACK_SIZEOF(filler_stack),
+                    STBS_CalibrationTask, NULL, NULL, NULL, STBS_DISPATCHER_PRIORITY, 0, K_FOREVER);
+#ifdef CONFIG_SCHED_CPU_MASK
+    k_thread_cpu_pin(&calibration_thread, arch_curr_cpu()->id);      // the round trips must switch this CPU
+#endif
+    k_thread_start(&calibration_thread);     // runs until it waits for the first wake-up
+
+    for (int run = 0; run < STBS_CALIBRATION_RUNS; run++) {
+        uint32_t start = k_cycle_get_32();
+        k_sem_give(&calibration_sem);           // back when it suspends itself
+        uint32_t woken = k_cycle_get_32();
+        k_thread_resume(&calibration_thread);   // back when it waits again
+        uint32_t end = k_cycle_get_32();
+
+        tick_cycles = MAX(tick_cycles, woken - start);
+        release_cycles = MAX(release_cycles, end - woken);
+    }
+    k_thread_abort(&calibration_thread);
+
+    STBS_FreeTable();
+    overhead.tick_us = k_cyc_to_us_ceil32(tick_cycles);
+    overhead.release_us = k_cyc_to_us_ceil32(release_cycles);
+    overhead_set = 1;
+    STBS_ResetStats();
+    printk("STBS overhead: %d us per tick, %d us per release\n", overhead.tick_us, overhead.release_us);
+    return 0;
+}
+
+/**
+ * @brief Sets the dispatcher overheads instead of measuring them (see STBS_Calibrate()),
+ * for example to 0 to check a task set on the execution times alone.
+ * @param new_overhead Overheads in us.
+ * @return 0 on success, -EINVAL if an overhead is negative, -EBUSY if the scheduler is running.
+ */
+int STBS_SetOverhead(const STBS_overhead *new_overhead) {
+    if (new_overhead->tick_us < 0 || new_overhead->release_us < 0) {
+        return -EINVAL;
+    }
+    if (stbs_running) {
+        return -EBUSY;
+    }
+    STBS_FreeTable();
+    overhead = *new_overhead;
+    overhead_set = 1;
+    return 0;
+}
+
+/**
+ * @brief Gets the dispatcher overheads counted in the table.
+ * @param current Where to store the overheads in us.
+ */
+void STBS_GetOverhead(STBS_overhead *current) {
+    *current = overhead;
+}
+
+/**
+ * @brief Sets the function called at the start of every tick, before the tasks of that tick are released.
+ * @param hook Function to call, or NULL to remove it.
+ */
+void STBS_SetTickHook(STBS_tick_hook hook) {
+    tick_hook = hook;
+}
+
+/**
+ * @brief Sets the function called when a fault is detected (see enum stbs_fault), e.g. to log it.
+ * Overruns, late releases and missed ticks are reported by the dispatchers, so the hook must not block.
+ * @param hook Function to call, or NULL to remove it.
+ */
+void STBS_SetFaultHook(STBS_fault_hook hook) {
+    fault_hook = hook;
+}
+
+// Reports a table that could not be built
+static int STBS_NotSchedulable(int ret) {
+    printk("System not schedulable\n");
+    if (fault_hook) {
+        fault_hook(STBS_FAULT_NOT_SCHEDULABLE, -1, ret);
+    }
+    return ret;
+}
+
 /**
  * @brief Adds a new task to the scheduler.
  * @param ticks Periodicity of the task in ticks.
  * @param task_id Task identifier (e.g., thread ID).
  * @param priority Task priority level.
- * @param execution_time Task execution time in ticks.
+ * @param execution_time Task execution time in microseconds.
  * @param name Task name.
  */
 
@@ -41,6 +295,10 @@ void STBS_Init(int tick_ms, int max_tasks) {
  * Adds a new task to the scheduler.
  */
 void STBS_AddTask(int ticks, k_tid_t task_id, int priority, int execution_time, char *name) {
+    if (!stbs.task_table) {
+        printk("Error: no task table (see STBS_Init())\n");
+        return;
+    }
     if (stbs.num_tasks >= stbs.max_tasks) {
         printk("Error: Maximum task limit reached\n");
         return;
@@ -56,8 +314,13 @@ void STBS_AddTask(int ticks, k_tid_t task_id, int priority, int execution_time,
             stbs.task_table[i].exec_time = execution_time;
             stbs.task_table[i].to_be_executed = 0;
             stbs.task_table[i].delay_count = 0;         // CHANGED
+            stbs.task_table[i].cpu = 0;
+            stbs.task_table[i].group = 0;
+            stbs.task_table[i].job = NULL;
+            stbs.task_table[i].job_arg = NULL;
+            stbs.task_table[i].max_jitter = -1;
             stbs.task_table[i].name = name;
-            
+            runtime[stbs.num_tasks].id = task_id;
 
             stbs.num_tasks++;
             printk("Added Task %s with period %d ticks\n",name, ticks);
@@ -67,206 +330,1980 @@ void STBS_AddTask(int ticks, k_tid_t task_id, int priority, int execution_time,
 }
 
 /**
- * @brief Schedules all the registered tasks and starts the scheduler .
+ * @brief Adds a job to the scheduler: a function that the dispatcher of its CPU calls
+ * every period and that runs to completion, so it needs no thread nor stack of its own
+ * (it runs on the dispatcher stack, see STBS_DISPATCHER_STACK_SIZE).
+ * In every tick the jobs run first, in table order, and then the thread tasks.
+ * The job is identified by STBS_JOB_ID(job), so a job function can be added only once.
+ * @param ticks Periodicity of the job in ticks.
+ * @param job Job function.
+ * @param arg Argument passed to the job function.
+ * @param priority Job priority level.
+ * @param execution_time Job execution time in microseconds.
+ * @param name Job name.
  */
-void STBS_Start() {
-    int64_t fin_time=0, release_time=0;     /* Timing variables to control task periodicity */
+void STBS_AddJob(int ticks, STBS_job job, void *arg, int priority, int execution_time, char *name) {
+    if (!job || STBS_FindTask(STBS_JOB_ID(job)) >= 0) {
+        printk("Error: invalid or duplicated job %s\n", name);
+        return;
+    }
+    STBS_AddTask(ticks, STBS_JOB_ID(job), priority, execution_time, name);
 
-    // Calculate macrocycle as the LCM of all task periods
-    int task_ticks[stbs.max_tasks];
-    for (int i = 0; i < stbs.num_tasks; i++) {
-        task_ticks[i] = stbs.task_table[i].ticks;
+    int i = STBS_FindTask(STBS_JOB_ID(job));
+    if (i >= 0) {
+        stbs.task_table[i].job = job;
+        stbs.task_table[i].job_arg = arg;
     }
-    stbs.macro_cycle = lcm_array(task_ticks, stbs.num_tasks);
+}
 
-    // Calculate the ticks in which each task will execute
-    qsort(stbs.task_table,stbs.num_tasks,sizeof(Task),compare_tasks);
+/**
+ * @brief Adds a rate group, with its own tick, table and dispatchers.
+ * The tick of a group cannot be shorter than the one of the previous group: the tasks of a
+ * group run below the tasks of the faster groups, so a group only gets the time of its tick
+ * that the faster groups leave on each CPU (see STBS_Check()). All the groups start together.
+ * @param tick_us Tick duration of the group in microseconds.
+ * @return Index of the group on success, -EINVAL if the tick is shorter than the one of the
+ *         previous group, -ENOMEM if STBS_MAX_GROUPS is reached, -EBUSY if the scheduler is running.
+ */
+int STBS_AddGroup(int tick_us) {
+    if (tick_us < stbs.groups[stbs.num_groups - 1].tick_us) {
+        return -EINVAL;
+    }
+    if (stbs_running) {
+        return -EBUSY;
+    }
+    if (stbs.num_groups >= STBS_MAX_GROUPS) {
+        printk("Error: Maximum rate group limit reached\n");
+        return -ENOMEM;
+    }
+    stbs.groups[stbs.num_groups].tick_us = tick_us;
+    stbs.groups[stbs.num_groups].macro_cycle = 0;
+    return stbs.num_groups++;
+}
 
-    // create the table with the times in which each task will execute
-    // in the first tick, all taks are ready
-    entry = k_malloc(stbs.macro_cycle * sizeof(scheduler_table_entry));
-    if (!entry) {
-        printk("Failed to allocate scheduler table\n");
-        return;
+/**
+ * @brief Moves a task to a rate group. Its period is then counted in ticks of that group.
+ * The tasks are added to group 0.
+ * @param task Task identifier.
+ * @param group Index of the group (see STBS_AddGroup()).
+ * @return 0 on success, -EINVAL if the task is not registered or the group does not exist,
+ *         -EBUSY if the scheduler is running.
+ */
+int STBS_SetGroup(k_tid_t task, int group) {
+    int i = STBS_FindTask(task);
+
+    if (i < 0 || group < 0 || group >= stbs.num_groups) {
+        return -EINVAL;
+    }
+    if (stbs_running) {
+        return -EBUSY;
     }
+    STBS_FreeTable();
+    stbs.task_table[i].group = group;
+    return 0;
+}
 
-    // initialize table entries
-    for(int j = 0; j< stbs.macro_cycle;j++){
-        entry[j].num_tasks = 0;
-        // entry[j].tick = j;
-        entry[j].tasks = k_malloc(stbs.num_tasks*sizeof(Task));
-        if (!entry[j].tasks) {
-            printk("Failed to allocate memory for tasks at tick %d\n", j);
-            // Free previously allocated entries to prevent memory leaks
-            for (int k = 0; k < j; k++) {
-                k_free(entry[k].tasks);
-            }
-            k_free(entry);
-            return;
+/**
+ * @brief Declares that a task reads the output of another one.
+ * In every tick the producer is placed before the consumer (on the same CPU), and the table
+ * is only accepted if every consumer job reads the output of a producer job released at most
+ * max_lag ticks before it. With max_lag = 0 both must run in the same tick, producer first.
+ * Both tasks must be in the same rate group.
+ * @param producer Task that writes the data.
+ * @param consumer Task that reads the data.
+ * @param max_lag Maximum lag in ticks.
+ * @return 0 on success, -EINVAL if the edge is invalid, -ENOMEM if STBS_MAX_PRECEDENCES is reached,
+ *         -EBUSY if the scheduler is running.
+ */
+int STBS_AddPrecedence(k_tid_t producer, k_tid_t consumer, int max_lag) {
+    if (producer == consumer || max_lag < 0) {
+        return -EINVAL;
+    }
+    if (stbs_running) {
+        return -EBUSY;
+    }
+    if (num_precedences >= STBS_MAX_PRECEDENCES) {
+        printk("Error: Maximum precedence limit reached\n");
+        return -ENOMEM;
+    }
+    STBS_FreeTable();
+    precedences[num_precedences].producer = producer;
+    precedences[num_precedences].consumer = consumer;
+    precedences[num_precedences].max_lag = max_lag;
+    num_precedences++;
+    return 0;
+}
+
+/**
+ * @brief Bounds the start-time jitter of a task: the spread, over the macro-cycle, of the
+ * time from the release of each of its jobs (the tick of its period) to its start.
+ * The constrained tasks are placed first in every tick, the tightest bound first (as far
+ * as the precedences allow, and threads after the jobs), and the table is only accepted
+ * if every bound holds.
+ * @param task Task identifier.
+ * @param max_jitter Maximum jitter in microseconds, or -1 to remove the bound.
+ * @return 0 on success, -EINVAL if the task is not registered or the bound is invalid,
+ *         -EBUSY if the scheduler is running.
+ */
+int STBS_SetMaxJitter(k_tid_t task, int max_jitter) {
+    int i = STBS_FindTask(task);
+
+    if (i < 0 || max_jitter < -1) {
+        return -EINVAL;
+    }
+    if (stbs_running) {
+        return -EBUSY;
+    }
+    STBS_FreeTable();
+    stbs.task_table[i].max_jitter = max_jitter;
+    return 0;
+}
+
+/**
+ * @brief Adds a task to the background lane: a thread outside the table, for the work without a
+ * period (protocol handling, logging, diagnostics). It is moved to STBS_BACKGROUND_PRIORITY(level),
+ * below every scheduled task, dispatcher and the filler, so it only runs in the time the tables
+ * leave idle (see STBS_GetBackgroundBudget()) and is preempted as soon as the next tick releases
+ * its tasks, without any cooperation from it, as long as it does not lock the scheduler or the
+ * interrupts. Within a level the tasks run by EDF once they set their deadline (see
+ * STBS_SetBackgroundDeadline()), in FIFO order otherwise. It is not pinned, so it takes the idle
+ * time of any CPU.
+ * @param task_id Thread of the task, preemptive.
+ * @param level Priority of the task in the lane, from 0 (highest) to STBS_BACKGROUND_LEVELS - 1.
+ * @param name Name of the task.
+ * @return 0 on success, -EINVAL if the level is invalid or the task is already in the table or the lane,
+ *         -ENOMEM if the lane is full.
+ */
+int STBS_AddBackground(k_tid_t task_id, int level, char *name) {
+    if (level < 0 || level >= STBS_BACKGROUND_LEVELS || STBS_FindTask(task_id) >= 0) {
+        return -EINVAL;
+    }
+    for (int i = 0; i < num_background; i++) {
+        if (background[i].id == task_id) {
+            return -EINVAL;
         }
-        entry[j].total_exec_time = 0;
+    }
+    if (num_background == STBS_MAX_BACKGROUND) {
+        return -ENOMEM;
+    }
+
+    STBS_background *b = &background[num_background];
+    b->id = task_id;
+    b->level = level;
+    b->name = name;
+#ifdef CONFIG_SCHED_THREAD_USAGE_ALL
+    k_thread_runtime_stats_t usage;
+    k_thread_runtime_stats_get(task_id, &usage);
+    b->usage_base = usage.execution_cycles;
+#endif
+    k_thread_priority_set(task_id, STBS_BACKGROUND_PRIORITY(level));
+    num_background++;
+    return 0;
+}
+
+/**
+ * @brief Sets the deadline of the current job of the calling background task, relative to now.
+ * The tasks of the same background level then run earliest deadline first. Needs CONFIG_SCHED_DEADLINE.
+ * @param deadline_us Deadline in microseconds.
+ * @return 0 on success, -EINVAL if the deadline is not positive or the caller is not a background task,
+ *         -ENOTSUP without CONFIG_SCHED_DEADLINE.
+ */
+int STBS_SetBackgroundDeadline(int deadline_us) {
+#ifdef CONFIG_SCHED_DEADLINE
+    k_tid_t self = k_current_get();
+    int i = 0;
 
+    while (i < num_background && background[i].id != self) {
+        i++;
     }
+    if (deadline_us <= 0 || i == num_background) {
+        return -EINVAL;
+    }
+    k_thread_deadline_set(self, k_us_to_cyc_ceil32(deadline_us));
+    return 0;
+#else
+    ARG_UNUSED(deadline_us);
+    return -ENOTSUP;
+#endif
+}
 
-    printk("Starting table computation\n");
-    // create the actual table
-    for(int tick = 0; tick < stbs.macro_cycle;tick++){
-
-        for(int task_idx = 0; task_idx < stbs.num_tasks; task_idx++){
-            if(tick == 0 || tick % stbs.task_table[task_idx].ticks == 0 || stbs.task_table[task_idx].to_be_executed){
-                if(stbs.task_table[task_idx].exec_time + entry[tick].total_exec_time <= stbs.tick_ms){
-                    entry[tick].tasks[entry[tick].num_tasks] = stbs.task_table[task_idx];
-                    entry[tick].total_exec_time += stbs.task_table[task_idx].exec_time;
-                    entry[tick].num_tasks++;
-                    stbs.task_table[task_idx].to_be_executed = 0;
-                    stbs.task_table[task_idx].delay_count = 0;    // CHANGED
-                }
-                else{
-                    stbs.task_table[task_idx].delay_count += 1; // CHANGED
-                    if(tick+1 > stbs.macro_cycle 
-                     || stbs.task_table[task_idx].delay_count >= stbs.task_table[task_idx].ticks){ // CHANGED
-                        printk("System not schedulable\n");
-                        for (int i = 0; i < stbs.macro_cycle; i++) {
-                            k_free(entry[i].tasks);
-                        }
-                        k_free(entry);
-                        return;
-                    }
-                    stbs.task_table[task_idx].to_be_executed = 1;
-                }
-            }
+/**
+ * @brief Finds a registered task.
+ * @param id Task identifier.
+ * @return Index of the task in the task table, or -1 if it is not registered.
+ */
+static int STBS_FindTask(k_tid_t id) {
+    for (int i = 0; i < stbs.num_tasks; i++) {
+        if (stbs.task_table[i].id == id) {
+            return i;
         }
     }
-    STBS_print_content();
-    printk("Starting STBS\n");
+    return -1;
+}
+
+// Records the first task that fails a condition of STBS_Check() in its report
+static void STBS_ReportFailure(STBS_check_report *report, int task, int cpu) {
+    if (report && report->failed_task < 0) {
+        report->failed_task = task;
+        report->failed_cpu = cpu;
+    }
+}
+
+/**
+ * @brief Checks that the tasks can be ordered so that every producer comes before its consumers,
+ * without reordering them.
+ * @param report Where to record the task that fails (can be NULL).
+ * @return 0 on success, -EINVAL if an edge names an unregistered task, joins two rate groups
+ *         or the edges form a cycle.
+ */
+static int STBS_CheckPrecedences(STBS_check_report *report) {
+    int placed[stbs.num_tasks];
+
+    for (int e = 0; e < num_precedences; e++) {
+        int producer = STBS_FindTask(precedences[e].producer);
+        int consumer = STBS_FindTask(precedences[e].consumer);
 
-    int current_tick = 0; // Keeps track of the current tick count
-    k_msleep(20); // let the tasks arrive at the point where they suspend themselves
-    while(1){
-        release_time = k_uptime_get() + stbs.tick_ms;
-        // uint64_t scheduler_start_time = k_uptime_get(); // Start measuring scheduler time
+        if (producer < 0 || consumer < 0) {
+            printk("Precedence %d: task not registered\n", e);
+            STBS_ReportFailure(report, MAX(producer, consumer), -1);
+            return -EINVAL;
+        }
+        if (stbs.task_table[producer].group != stbs.task_table[consumer].group) {
+            printk("Precedence %d: tasks in different rate groups\n", e);
+            STBS_ReportFailure(report, consumer, -1);
+            return -EINVAL;
+        }
+    }
 
-        for(int i = 0; i <stbs.macro_cycle;i++){
-            current_tick++;
-            // int n_executed_tasks = 0;
+    // place the tasks whose producers are all placed until none is left: a cycle leaves some out
+    memset(placed, 0, sizeof(placed));
+    for (int n = 0; n < stbs.num_tasks; n++) {
+        int pick = -1;
 
-            // uint64_t iteration_start_time = k_uptime_get(); // Start timing the iteration
+        for (int i = 0; i < stbs.num_tasks && pick < 0; i++) {
+            int ready = !placed[i];
 
-            for(int task_idx = 0; task_idx < entry[i].num_tasks; task_idx++){
-                // uint64_t task_start_time = k_uptime_get(); // Time before resuming a task
+            for (int e = 0; e < num_precedences && ready; e++) {
+                if (precedences[e].consumer == stbs.task_table[i].id) {
+                    ready = placed[STBS_FindTask(precedences[e].producer)];
+                }
+            }
+            if (ready) {
+                pick = i;
+            }
+        }
+        if (pick < 0) {
+            printk("Precedence cycle between the tasks\n");
+            for (int i = 0; i < stbs.num_tasks && pick < 0; i++) {
+                pick = placed[i] ? -1 : i;
+            }
+            STBS_ReportFailure(report, pick, -1);
+            return -EINVAL;
+        }
+        placed[pick] = 1;
+    }
+    return 0;
+}
 
-                k_tid_t task_id = entry[i].tasks[task_idx].id;
-                k_thread_resume(task_id);
+/**
+ * @brief Reorders the task table so that every producer comes before its consumers.
+ * Among the tasks whose producers are already placed, the first in compare_tasks() order
+ * is taken, so without precedences the order is left untouched.
+ * The edges must have been checked with STBS_CheckPrecedences().
+ */
+static void STBS_OrderPrecedences(void) {
+    for (int n = 0; n < stbs.num_tasks && num_precedences > 0; n++) {
+        int pick = -1;
 
-                // uint64_t task_end_time = k_uptime_get(); // Time after resuming the task
-                // n_executed_tasks++;
+        // the tasks before n are placed
+        for (int i = n; i < stbs.num_tasks && pick < 0; i++) {
+            int ready = 1;
 
-                // // Log task overhead if necessary
-                // printk("Task %d resume time: %llu ms\n", task_idx, task_end_time - task_start_time);
+            for (int e = 0; e < num_precedences && ready; e++) {
+                if (precedences[e].consumer == stbs.task_table[i].id) {
+                    ready = STBS_FindTask(precedences[e].producer) < n;
+                }
             }
+            if (ready) {
+                pick = i;
+            }
+        }
+        // move it to n, the ones not placed yet keep their order
+        Task task = stbs.task_table[pick];
+        memmove(&stbs.task_table[n + 1], &stbs.task_table[n], (pick - n) * sizeof(Task));
+        stbs.task_table[n] = task;
+    }
+}
 
-            // uint64_t iteration_end_time = k_uptime_get(); // End timing the iteration
-            // printk("Macro cycle %d iteration overhead: %llu ms\n", i, iteration_end_time - iteration_start_time);
+/**
+ * @brief Orders the task table as the builder places the tasks in every tick: by compare_tasks(),
+ * then the tasks with a jitter bound first (the tightest first), every producer before its
+ * consumers, and the jobs before the threads.
+ */
+static void STBS_OrderTasks(void) {
+    qsort(stbs.task_table,stbs.num_tasks,sizeof(Task),compare_tasks);
+    // the tasks with a jitter bound go first, so that fewer tasks can start before them
+    for (int i = 1; i < stbs.num_tasks; i++) {
+        for (int j = i; j > 0 && stbs.task_table[j].max_jitter >= 0 &&
+             (stbs.task_table[j - 1].max_jitter < 0 || stbs.task_table[j].max_jitter < stbs.task_table[j - 1].max_jitter); j--) {
+            Task tmp = stbs.task_table[j];
+            stbs.task_table[j] = stbs.task_table[j - 1];
+            stbs.task_table[j - 1] = tmp;
+        }
+    }
+    STBS_OrderPrecedences();
+    // the jobs of a tick run before its threads are released (see STBS_Dispatcher()), keep them first
+    for (int i = 1; i < stbs.num_tasks; i++) {
+        for (int j = i; j > 0 && stbs.task_table[j].job && !stbs.task_table[j - 1].job; j--) {
+            Task tmp = stbs.task_table[j];
+            stbs.task_table[j] = stbs.task_table[j - 1];
+            stbs.task_table[j - 1] = tmp;
+        }
+    }
+}
 
-            fin_time = k_uptime_get();
-            if( fin_time < release_time) {
-                k_msleep(release_time - fin_time);
-                release_time += stbs.tick_ms;
+// Ticks of the table of a group kept in memory: its window, or its whole macro-cycle
+static int STBS_TableLength(int group) {
+    return stbs.window ? stbs.window : stbs.groups[group].macro_cycle;
+}
+
+/**
+ * @brief Frees the scheduler tables of all the groups, if any.
+ */
+static void STBS_FreeTable(void) {
+    for (int group = 0; group < STBS_MAX_GROUPS; group++) {
+        for (int cpu = 0; cpu < STBS_MAX_CPUS; cpu++) {
+            if (entry[group][cpu]) {
+                for (int i = 0; i < STBS_TableLength(group); i++) {
+                    k_free(entry[group][cpu][i].tasks);
+                }
+                k_free(entry[group][cpu]);
+                entry[group][cpu] = NULL;
             }
         }
+        k_free(window_seq[group]);
+        window_seq[group] = NULL;
+        stbs.groups[group].macro_cycle = 0;
+    }
+}
 
-        // uint64_t scheduler_end_time = k_uptime_get(); // End measuring scheduler time
-        // printk("Total scheduler overhead for macro cycle: %llu ms\n", scheduler_end_time - scheduler_start_time);
+// 1 if the table of some group was built
+static int STBS_HasTable(void) {
+    for (int group = 0; group < stbs.num_groups; group++) {
+        if (stbs.groups[group].macro_cycle > 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
 
-        current_tick = 0;
+// Time a task takes from the tick of the dispatcher: its execution time and its release overhead
+static int STBS_Cost(const Task *t) {
+    return t->exec_time + overhead.release_us;
+}
 
-        
+// Time the dispatcher of a group takes in every tick besides the releases (0 if the group has no dispatchers)
+static int STBS_TickOverhead(int group) {
+    for (int i = 0; i < stbs.num_tasks; i++) {
+        if (stbs.task_table[i].group == group) {
+            return overhead.tick_us;
+        }
     }
-    timing_stop();
+    return 0;
 }
 
+// Utilization of a task, in per-mille of its CPU
+static int STBS_TaskUtilization(const Task *t) {
+    return ((int64_t)STBS_Cost(t) * 1000) / ((int64_t)t->ticks * stbs.groups[t->group].tick_us);
+}
 
-// #include <stdio.h> // Needed for snprintf if used
+// CPU of a task: in a partition being checked (see STBS_Partition()), or the one it is assigned to if cpus is NULL
+static int STBS_TaskCpu(const int *cpus, int task) {
+    return cpus ? cpus[task] : stbs.task_table[task].cpu;
+}
 
 /**
- * @brief Prints the contents of the scheduler table.
+ * @brief Computes the time of every tick of a group left on a CPU by the faster groups.
+ * A tick of a faster group takes at most its tick overhead plus the cost of all the tasks of
+ * that group on the CPU (and never more than its own capacity), and is counted for every one
+ * of its ticks that overlaps the tick of the group.
+ * @param group Rate group.
+ * @param cpu CPU of the tasks.
+ * @param cpus CPU of each task (see STBS_TaskCpu()).
+ * @return Time in us (the whole tick for group 0, 0 if the faster groups may take it all),
+ *         including the tick overhead of the group itself.
  */
-void STBS_print_content() {
-    // Constants for table formatting
-    const char *table_header =  "| Tick | Task Name      | Execution Time | Priority |\n";
-    const char *table_divider = "+------+----------------+----------------+----------+\n";
+static int STBS_GroupCapacity(int group, int cpu, const int *cpus) {
+    int tick_us = stbs.groups[group].tick_us;
+    int64_t capacity = tick_us;
 
-    // Check for empty scheduler table
-    if (stbs.macro_cycle == 0) {
-        printk("Scheduler table is empty.\n");
-        return;
+    for (int h = 0; h < group; h++) {
+        int h_tick_us = stbs.groups[h].tick_us;
+        int64_t busy = STBS_TickOverhead(h);
+
+        for (int i = 0; i < stbs.num_tasks; i++) {
+            if (stbs.task_table[i].group == h && STBS_TaskCpu(cpus, i) == cpu) {
+                busy += STBS_Cost(&stbs.task_table[i]);
+            }
+        }
+        if (busy > 0) {
+            int overlaps = tick_us / h_tick_us + (tick_us % h_tick_us ? 2 : 0);
+            capacity -= overlaps * MIN(busy, (int64_t)STBS_GroupCapacity(h, cpu, cpus));
+        }
     }
+    return capacity > 0 ? (int)capacity : 0;
+}
 
-    printk("Printing scheduler table contents:\n");
-    printk("%s", table_divider);
-    printk("%s", table_header);
-    printk("%s", table_divider);
-
-    for (int tick = 0; tick < stbs.macro_cycle; tick++) {
-        if (entry[tick].num_tasks == 0) {
-            // Print empty tick row
-            printk("| %4d | %-14s | %-14s | %-8s |\n", tick, "No tasks", "-", "-");
+/**
+ * @brief Runs the per-CPU schedulability conditions of STBS_Check() on the tasks of one group and CPU.
+ * The tasks of a group only have the capacity of its tick that the faster groups leave (see STBS_GroupCapacity()),
+ * less the tick overhead of its dispatcher, and every task costs its release overhead on top of its
+ * execution time (see STBS_Calibrate()).
+ * @param group Rate group whose tasks are checked.
+ * @param cpu CPU whose tasks are checked.
+ * @param cpus CPU of each task (see STBS_TaskCpu()).
+ * @param report Where to add the tick demand of the group and CPU, and the task that fails (can be NULL).
+ * @param utilization Where to store the utilization of the group on the CPU, in per-mille (can be NULL).
+ * @param verbose Print the violations.
+ * @return 0 if the tasks may be schedulable, -ENOSPC otherwise.
+ */
+static int STBS_CheckCpu(int group, int cpu, const int *cpus, STBS_check_report *report, int *utilization, int verbose) {
+    int tick_us = stbs.groups[group].tick_us;
+    int tick_overhead = STBS_TickOverhead(group);
+    int capacity = STBS_GroupCapacity(group, cpu, cpus) - tick_overhead;     // for the tasks
+    int heaviest = -1;
+    int64_t hyperperiod = 1;
+    int64_t demand = 0;
+    int tick_demand = 0;
+    int group_utilization = 0;
+    int ret = 0;
+
+    for (int i = 0; i < stbs.num_tasks; i++) {
+        Task *t = &stbs.task_table[i];
+
+        if (STBS_TaskCpu(cpus, i) != cpu || t->group != group) {
             continue;
         }
+        if (STBS_Cost(t) > capacity) {
+            if (verbose) {
+                printk("Task %s: execution time %d us (+%d us overhead) does not fit in the %d us available per tick\n",
+                    t->name, t->exec_time, overhead.release_us, capacity);
+            }
+            STBS_ReportFailure(report, i, cpu);
+            ret = -ENOSPC;
+        }
+        if (heaviest < 0 || STBS_TaskUtilization(t) > STBS_TaskUtilization(&stbs.task_table[heaviest])) {
+            heaviest = i;
+        }
+        tick_demand += STBS_Cost(t);
+        if (hyperperiod <= INT_MAX) {
+            hyperperiod = (hyperperiod / gcd((int)hyperperiod, t->ticks)) * t->ticks;
+        }
+    }
+
+    // utilization over the macro-cycle (exact while the macro-cycle fits in an int)
+    if (hyperperiod <= INT_MAX) {
+        for (int i = 0; i < stbs.num_tasks; i++) {
+            if (STBS_TaskCpu(cpus, i) == cpu && stbs.task_table[i].group == group) {
+                demand += (int64_t)STBS_Cost(&stbs.task_table[i]) * (hyperperiod / stbs.task_table[i].ticks);
+            }
+        }
+        group_utilization = ((demand + hyperperiod * tick_overhead) * 1000) / (hyperperiod * tick_us);
+        if (demand > hyperperiod * capacity) {
+            if (verbose) {
+                printk("CPU %d: utilization %d.%d%% exceeds the %d us available per tick:\n",
+                    cpu, group_utilization / 10, group_utilization % 10, capacity);
+                for (int i = 0; i < stbs.num_tasks; i++) {
+                    Task *t = &stbs.task_table[i];
+                    if (STBS_TaskCpu(cpus, i) == cpu && t->group == group) {
+                        int task_utilization = ((int64_t)STBS_Cost(t) * 1000) / ((int64_t)t->ticks * tick_us);
+                        printk("  Task %s: %d.%d%%\n", t->name, task_utilization / 10, task_utilization % 10);
+                    }
+                }
+            }
+            STBS_ReportFailure(report, heaviest, cpu);    // the task that takes the most of the CPU
+            ret = -ENOSPC;
+        }
+    }
 
-        for (int task_idx = 0; task_idx < entry[tick].num_tasks; task_idx++) {
-            Task current_task = entry[tick].tasks[task_idx];
-            
-            // Print task row
-            printk("| %4d | %-14s | %-14d | %-8d |\n", 
-                tick, 
-                current_task.name, 
-                current_task.exec_time,  
-                current_task.priority    
-            );
+    // demand of the jobs that must complete within the first L ticks, for L = each period
+    for (int i = 0; i < stbs.num_tasks && ret == 0; i++) {
+        int window = stbs.task_table[i].ticks;
+        int64_t window_demand = 0;
+        int seen = 0;
+
+        if (STBS_TaskCpu(cpus, i) != cpu || stbs.task_table[i].group != group) {
+            continue;
         }
+        for (int j = 0; j < i; j++) {
+            seen |= STBS_TaskCpu(cpus, j) == cpu && stbs.task_table[j].group == group && stbs.task_table[j].ticks == window;
+        }
+        if (seen) {
+            continue;
+        }
+        for (int j = 0; j < stbs.num_tasks; j++) {
+            if (STBS_TaskCpu(cpus, j) == cpu && stbs.task_table[j].group == group) {
+                window_demand += (int64_t)(window / stbs.task_table[j].ticks) * STBS_Cost(&stbs.task_table[j]);
+            }
+        }
+        if (window_demand > (int64_t)window * capacity) {
+            if (verbose) {
+                printk("Task %s: tasks with period <= %d ticks need %lld us in %d ticks (only %lld us available)\n",
+                    stbs.task_table[i].name, window, (long long)window_demand, window, (long long)window * capacity);
+            }
+            STBS_ReportFailure(report, i, cpu);
+            ret = -ENOSPC;
+        }
+    }
 
-        // Print total execution time row for this tick
-        printk("| %4s | %-14s | %-14d | %-8s |\n", 
-            "-", 
-            "Total Time", 
-            entry[tick].total_exec_time, 
-            "-"
-        );
-        printk("%s", table_divider);
+    if (report) {
+        report->max_tick_demand = MAX(report->max_tick_demand, tick_demand);
+        report->sufficient = report->sufficient && tick_demand <= capacity;
     }
+    if (utilization) {
+        *utilization = group_utilization;
+    }
+    return ret;
 }
 
-void STBS_destroy(){
-    for (int i = 0; i < stbs.macro_cycle; i++) {
-        k_free(entry[i].tasks);
+// Sets the release state of the tasks of a group and CPU (all of them with cpu = -1) for tick 0
+static void STBS_ResetReleases(int group, int cpu) {
+    for (int i = 0; i < stbs.num_tasks; i++) {
+        if (stbs.task_table[i].group == group && (cpu < 0 || stbs.task_table[i].cpu == cpu)) {
+            stbs.task_table[i].next_activation = 0;
+            stbs.task_table[i].to_be_executed = 0;
+            stbs.task_table[i].delay_count = 0;
+        }
     }
-    k_free(entry);
+}
 
-     // Free the task table and reset fields
-    if (stbs.task_table) {
-        k_free(stbs.task_table);
-        stbs.task_table = NULL;
+/**
+ * @brief Places the tasks of one group and CPU that are released or deferred in a tick.
+ * The released tasks are taken in the order of the task table (see compare_tasks());
+ * a task that does not fit in the time left in the tick (of the capacity of the group, see
+ * STBS_GroupCapacity()) is deferred to the next tick, at most until its next release.
+ * The time of the tick includes the dispatcher overheads (see STBS_Calibrate()).
+ * The ticks must be placed in order from tick 0, which STBS_ResetReleases() prepares.
+ * @param group Rate group whose tasks are placed.
+ * @param cpu CPU whose tasks are placed.
+ * @param capacity Time of the tick the tasks can use, in us.
+ * @param tick Position of the tick in the macro-cycle.
+ * @param tick_entry Entry of the tick, or NULL for a dry run that stores nothing.
+ * @return 0 on success, -ENOSPC if a task cannot be placed before its next release.
+ */
+static int STBS_FillTick(int group, int cpu, int capacity, int tick, scheduler_table_entry *tick_entry) {
+    int total_exec_time = STBS_TickOverhead(group);
+
+    if (tick_entry) {
+        tick_entry->num_tasks = 0;
     }
-    stbs.num_tasks = 0;
-    stbs.macro_cycle = 0;
+    for(int task_idx = 0; task_idx < stbs.num_tasks; task_idx++){
+        Task *task = &stbs.task_table[task_idx];
+
+        if (task->cpu != cpu || task->group != group) {
+            continue;
+        }
+        if (tick == task->next_activation) {
+            task->next_activation += task->ticks;
+        } else if (!task->to_be_executed) {
+            continue;
+        }
+        if(STBS_Cost(task) + total_exec_time <= capacity){
+            if (tick_entry) {
+                tick_entry->tasks[tick_entry->num_tasks] = *task;
+                tick_entry->num_tasks++;
+            }
+            total_exec_time += STBS_Cost(task);
+            task->to_be_executed = 0;
+            task->delay_count = 0;    // CHANGED
+        }
+        else{
+            task->delay_count += 1; // CHANGED
+            if(task->delay_count >= task->ticks){ // CHANGED
+                return -ENOSPC;
+            }
+            task->to_be_executed = 1;
+        }
+    }
+    if (tick_entry) {
+        tick_entry->total_exec_time = total_exec_time;
+    }
+    return 0;
 }
 
+/**
+ * @brief Places the tasks of one group and CPU in the ticks of its table, or only checks that they can be placed
+ * (see STBS_FillTick()).
+ * @param group Rate group whose tasks are placed.
+ * @param cpu CPU whose tasks are placed.
+ * @param macro_cycle Number of ticks of the table.
+ * @param cpu_entry Table of the group and CPU, or NULL for a dry run that stores nothing.
+ * @return 0 on success, -ENOSPC if a task cannot be placed before its next release.
+ */
+static int STBS_FillCpu(int group, int cpu, int macro_cycle, scheduler_table_entry *cpu_entry) {
+    int capacity = STBS_GroupCapacity(group, cpu, NULL);
 
-// testing functions
-int STBS_GetNumTasks(void) {
-    return stbs.num_tasks;
+    STBS_ResetReleases(group, cpu);
+    for(int tick = 0; tick < macro_cycle;tick++){
+        if (STBS_FillTick(group, cpu, capacity, tick, cpu_entry ? &cpu_entry[tick] : NULL) != 0) {
+            return -ENOSPC;
+        }
+    }
+    return 0;
 }
 
-int STBS_GetTickMs(void) {
-    return stbs.tick_ms;
-}
+/**
+ * @brief Fills the next tick of the window of a group, on all the CPUs (called with window_lock held).
+ * The release state of the tasks is reset at the start of every macro-cycle, so the window
+ * holds the same ticks as the whole table.
+ */
+static void STBS_FillWindowTick(int group) {
+    uint32_t seq = filled_seq[group];
+    int slot = seq % stbs.window;
 
-const Task* STBS_GetTaskTable(void) {
-    return stbs.task_table;
+    if (fill_tick[group] == 0) {
+        STBS_ResetReleases(group, -1);
+    }
+    for (int cpu = 0; cpu < stbs.num_cpus; cpu++) {
+        // cannot fail: the whole macro-cycle was placed when the table was built
+        STBS_FillTick(group, cpu, STBS_GroupCapacity(group, cpu, NULL), fill_tick[group], &entry[group][cpu][slot]);
+    }
+    window_seq[group][slot] = seq;
+    fill_tick[group] = (fill_tick[group] + 1) % stbs.groups[group].macro_cycle;
+    filled_seq[group] = seq + 1;
 }
 
-int STBS_GetMacroCycle(void) {
-    return stbs.macro_cycle;
+// Whether the next tick to fill takes a slot no dispatcher of the group is reading (called with window_lock held)
+static int STBS_WindowSlotFree(int group) {
+    for (int cpu = 0; cpu < stbs.num_cpus; cpu++) {
+        if ((int32_t)(filled_seq[group] - held_seq[group][cpu]) >= stbs.window) {
+            return 0;       // a late dispatcher is still releasing the tick that held the slot
+        }
+    }
+    return 1;
 }
 
+/**
+ * @brief Fills the window of a group up to some ticks after the one being released, stopping
+ * before a slot whose tick a dispatcher is still releasing.
+ * @param group Rate group.
+ * @param ahead Ticks after the one being released to fill, at most the window minus 1.
+ * @return Number of ticks filled.
+ */
+static int STBS_FillWindow(int group, int ahead) {
+    int filled = 0;
+
+    while (1) {
+        // one tick at a time, so a dispatcher never waits for long
+        k_spinlock_key_t key = k_spin_lock(&window_lock);
+        int fill = (int32_t)(filled_seq[group] - release_seq[group]) <= ahead && STBS_WindowSlotFree(group);
+
+        if (fill) {
+            STBS_FillWindowTick(group);
+            filled++;
+        }
+        k_spin_unlock(&window_lock, key);
+        if (!fill) {
+            return filled;
+        }
+    }
+}
+
+// Load planned by the tables of all the groups on a CPU (tasks and dispatcher overheads), in per-mille
+static uint32_t STBS_PlannedLoad(int cpu) {
+    uint32_t load = 0;
+
+    for (int group = 0; group < stbs.num_groups; group++) {
+        int macro_cycle = stbs.groups[group].macro_cycle;
+        int64_t busy = 0;
+        for (int i = 0; i < stbs.num_tasks; i++) {
+            const Task *t = &stbs.task_table[i];
+            if (t->cpu == cpu && t->group == group) {
+                busy += (int64_t)STBS_Cost(t) * (macro_cycle / t->ticks);
+            }
+        }
+        busy += (int64_t)macro_cycle * STBS_TickOverhead(group);
+        load += macro_cycle ? (busy * 1000) / ((int64_t)macro_cycle * stbs.groups[group].tick_us) : 0;
+    }
+    return load;
+}
+
+/**
+ * @brief Assigns every task to a CPU (first-fit decreasing on utilization).
+ * The tasks are taken from the highest utilization down, and each goes to the first
+ * CPU where the per-CPU schedulability conditions still hold for its group and the slower
+ * ones (which it takes time from) and, if their macro-cycles are given, where a dry run of
+ * the table builder still succeeds. A task that fits nowhere goes to the least loaded CPU,
+ * where STBS_Check() then reports it.
+ * The dry runs cost a table build per task, CPU and group, so STBS_BuildTable() only asks for
+ * them when the tables of the analytical partition cannot be built.
+ * @param cpus Where to store the CPU of each task, or NULL to assign the tasks themselves.
+ * @param macro_cycle Macro-cycle of each group for the dry runs (only with cpus NULL), or NULL to skip them.
+ */
+static void STBS_Partition(int *cpus, const int *macro_cycle) {
+    int order[stbs.num_tasks];
+    int load[STBS_MAX_CPUS] = {0};     // per-mille of the CPU
+
+    for (int i = 0; i < stbs.num_tasks; i++) {
+        *(cpus ? &cpus[i] : &stbs.task_table[i].cpu) = stbs.num_cpus == 1 ? 0 : -1;
+        order[i] = i;
+    }
+    if (stbs.num_cpus == 1) {
+        return;
+    }
+
+    // insertion sort by decreasing utilization (C_i / (T_i * tick))
+    for (int i = 1; i < stbs.num_tasks; i++) {
+        int k = order[i], j = i - 1;
+        Task *tk = &stbs.task_table[k];
+        while (j >= 0 && (int64_t)STBS_Cost(&stbs.task_table[order[j]]) * tk->ticks * stbs.groups[tk->group].tick_us <
+                         (int64_t)STBS_Cost(tk) * stbs.task_table[order[j]].ticks * stbs.groups[stbs.task_table[order[j]].group].tick_us) {
+            order[j + 1] = order[j];
+            j--;
+        }
+        order[j + 1] = k;
+    }
+
+    for (int i = 0; i < stbs.num_tasks; i++) {
+        Task *t = &stbs.task_table[order[i]];
+        int *cpu_of = cpus ? &cpus[order[i]] : &t->cpu;
+        int least_loaded = 0;
+
+        for (int cpu = 0; cpu < stbs.num_cpus && *cpu_of < 0; cpu++) {
+            *cpu_of = cpu;
+            for (int group = t->group; group < stbs.num_groups && *cpu_of >= 0; group++) {
+                if (STBS_CheckCpu(group, cpu, cpus, NULL, NULL, 0) != 0 ||
+                    (macro_cycle && macro_cycle[group] > 0 && STBS_FillCpu(group, cpu, macro_cycle[group], NULL) != 0)) {
+                    *cpu_of = -1;
+                }
+            }
+            if (load[cpu] < load[least_loaded]) {
+                least_loaded = cpu;
+            }
+        }
+        if (*cpu_of < 0) {
+            *cpu_of = least_loaded;
+        }
+        load[*cpu_of] += STBS_TaskUtilization(t);
+    }
+}
+
+/**
+ * @brief Checks the registered tasks analytically, without building the table.
+ *
+ * It changes nothing: the task table, its order and the CPUs of the tasks are left as they are,
+ * and nothing is allocated. On multi-core systems the tasks are first partitioned among the CPUs
+ * (see STBS_Partition()), as the builder then assigns them.
+ * Then, for the tasks of each group and CPU, it runs necessary conditions that the table builder
+ * cannot get around, in O(n * p) for n tasks with p distinct periods:
+ *  - every task fits in one tick;
+ *  - the total utilization does not exceed the tick;
+ *  - the jobs released at tick 0 with a deadline within the first L ticks fit in those
+ *    L ticks, for every task period L (a job can be deferred at most until its next release);
+ * and finally checks that the macro-cycles and their tables (or windows, see STBS_SetWindow()) fit in memory.
+ * For the slower rate groups, the tick in these conditions is the time the faster groups leave
+ * in it (see STBS_GroupCapacity()).
+ * Every violation is printed with the task that causes it, and the first one is reported.
+ * @param report Where to store the computed figures (can be NULL).
+ * @return 0 if the set may be schedulable (report->sufficient tells if it is for sure),
+ *         -EINVAL if a task has invalid parameters or the precedences are invalid (see STBS_AddPrecedence()),
+ *         -ENOSPC if the set is not schedulable, -E2BIG if the tables would not fit in STBS_MAX_TABLE_BYTES.
+ */
+int STBS_Check(STBS_check_report *report) {
+    STBS_check_report r = {0};
+    int64_t hyperperiod[STBS_MAX_GROUPS];
+    int group_tasks[STBS_MAX_GROUPS] = {0};
+    int utilization[STBS_MAX_CPUS] = {0};
+    int cpus[stbs.num_tasks];
+    int ret = 0;
+
+    r.hyperperiod = 1;
+    r.sufficient = 1;
+    r.failed_task = -1;
+    r.failed_cpu = -1;
+    for (int group = 0; group < STBS_MAX_GROUPS; group++) {
+        hyperperiod[group] = 1;
+    }
+    for (int i = 0; i < stbs.num_tasks && ret == 0; i++) {
+        Task *t = &stbs.task_table[i];
+
+        if (t->ticks <= 0 || t->exec_time < 0) {
+            printk("Task %s: invalid period (%d ticks) or execution time (%d us)\n", t->name, t->ticks, t->exec_time);
+            STBS_ReportFailure(&r, i, -1);
+            ret = -EINVAL;
+            break;
+        }
+        group_tasks[t->group]++;
+        if (hyperperiod[t->group] <= INT_MAX) {
+            hyperperiod[t->group] = (hyperperiod[t->group] / gcd((int)hyperperiod[t->group], t->ticks)) * t->ticks;
+        }
+    }
+    if (ret == 0) {
+        ret = STBS_CheckPrecedences(&r);
+    }
+    if (ret != 0) {
+        if (report) {
+            *report = r;
+        }
+        return ret;
+    }
+    for (int group = 0; group < stbs.num_groups; group++) {
+        if (group_tasks[group] > 0) {
+            int64_t length = stbs.window ? stbs.window : hyperperiod[group];
+
+            r.hyperperiod = MAX(r.hyperperiod, hyperperiod[group]);
+            r.table_bytes += length * (stbs.num_cpus * sizeof(scheduler_table_entry) + group_tasks[group] * sizeof(Task));
+            if (stbs.window) {
+                r.table_bytes += length * sizeof(uint32_t);
+            }
+        }
+    }
+
+    STBS_Partition(cpus, NULL);
+    for (int group = 0; group < stbs.num_groups; group++) {
+        for (int cpu = 0; cpu < stbs.num_cpus; cpu++) {
+            int group_utilization;
+
+            if (STBS_CheckCpu(group, cpu, cpus, &r, &group_utilization, 1) != 0) {
+                ret = -ENOSPC;
+            }
+            utilization[cpu] += group_utilization;
+            r.utilization = MAX(r.utilization, utilization[cpu]);
+        }
+    }
+
+    if (ret == 0 && (r.hyperperiod > INT_MAX || r.table_bytes > STBS_MAX_TABLE_BYTES)) {
+        printk("Macro-cycle of %lld ticks needs a %lld bytes table (limit %d bytes)\n",
+            (long long)r.hyperperiod, (long long)r.table_bytes, STBS_MAX_TABLE_BYTES);
+        ret = -E2BIG;
+    }
+
+    if (report) {
+        *report = r;
+    }
+    return ret;
+}
+
+/**
+ * @brief Builds the scheduler tables of all the rate groups, without starting the scheduler.
+ * Any previously built table is freed first. The task set is checked with STBS_Check() first,
+ * so infeasible sets are rejected before anything is allocated. Then the task table is ordered
+ * as the tasks are placed in every tick and, on multi-core systems, partitioned among the CPUs.
+ * With a window (see STBS_SetWindow()) only its first ticks are stored.
+ * @return 0 on success, -ENOMEM if a table (or the task table, see STBS_Init()) could not be allocated,
+ *         -ENOSPC if the task set is not schedulable, -EINVAL or -E2BIG (see STBS_Check()),
+ *         -ENOTSUP if a window is set with precedences or jitter bounds, -EBUSY if the scheduler is running.
+ */
+int STBS_BuildTable(void) {
+    if (stbs_running) {
+        return -EBUSY;      // the dispatcher is using the current table
+    }
+    if (init_error) {
+        return init_error;  // STBS_Init() failed: the tasks were not added
+    }
+    STBS_FreeTable();
+    if (stbs.num_tasks == 0) {
+        return 0;
+    }
+
+    int ret = STBS_Check(NULL);
+    if (ret != 0) {
+        return STBS_NotSchedulable(ret);
+    }
+    if (stbs.window) {
+        int constrained = num_precedences > 0;
+        for (int i = 0; i < stbs.num_tasks; i++) {
+            constrained |= stbs.task_table[i].max_jitter >= 0;
+        }
+        if (constrained) {
+            printk("Precedences and jitter bounds need the whole table, not a window\n");
+            return -ENOTSUP;
+        }
+    }
+
+    // Assign the tasks to the CPUs as STBS_Check() did, on the analytical conditions alone,
+    // then order them as the builder places them in every tick
+    int macro_cycle[STBS_MAX_GROUPS] = {0};
+    STBS_Partition(NULL, NULL);
+    STBS_OrderTasks();
+    for (int group = 0; group < stbs.num_groups; group++) {
+        // Calculate macrocycle as the LCM of the periods of the tasks of the group
+        int task_ticks[stbs.max_tasks];
+        int group_tasks = 0;
+        for (int i = 0; i < stbs.num_tasks; i++) {
+            if (stbs.task_table[i].group == group) {
+                task_ticks[group_tasks++] = stbs.task_table[i].ticks;
+            }
+        }
+        macro_cycle[group] = group_tasks > 0 ? lcm_array(task_ticks, group_tasks) : 0;
+    }
+    // with several CPUs, if a table of that partition cannot be built, place the tasks again
+    // where dry runs of the builder succeed (on one CPU there is no other partition to try)
+    for (int group = 0; group < stbs.num_groups && stbs.num_cpus > 1; group++) {
+        int built = 1;
+        for (int cpu = 0; cpu < stbs.num_cpus && built && macro_cycle[group] > 0; cpu++) {
+            built = STBS_FillCpu(group, cpu, macro_cycle[group], NULL) == 0;
+        }
+        if (!built) {
+            STBS_Partition(NULL, macro_cycle);
+            break;
+        }
+    }
+
+    for (int group = 0; group < stbs.num_groups; group++) {
+        if (macro_cycle[group] == 0) {
+            continue;       // no table nor dispatchers
+        }
+
+        // create the tables with the times in which each task will execute (one per CPU)
+        // in the first tick, all taks are ready
+        stbs.groups[group].macro_cycle = macro_cycle[group];
+        int length = STBS_TableLength(group);
+        for (int cpu = 0; cpu < stbs.num_cpus; cpu++) {
+            int cpu_tasks = 0;
+            for (int i = 0; i < stbs.num_tasks; i++) {
+                cpu_tasks += stbs.task_table[i].cpu == cpu && stbs.task_table[i].group == group;
+            }
+
+            entry[group][cpu] = k_malloc(length * sizeof(scheduler_table_entry));
+            if (!entry[group][cpu]) {
+                printk("Failed to allocate scheduler table\n");
+                STBS_FreeTable();
+                return -ENOMEM;
+            }
+            memset(entry[group][cpu], 0, length * sizeof(scheduler_table_entry));
+
+            // initialize table entries
+            for(int j = 0; j< length && cpu_tasks > 0;j++){
+                // entry[j].tick = j;
+                entry[group][cpu][j].tasks = k_malloc(cpu_tasks*sizeof(Task));
+                if (!entry[group][cpu][j].tasks) {
+                    printk("Failed to allocate memory for tasks at tick %d\n", j);
+                    // Free previously allocated entries to prevent memory leaks
+                    STBS_FreeTable();
+                    return -ENOMEM;
+                }
+            }
+        }
+
+        // create the actual tables (only run them through if they are streamed)
+        for (int cpu = 0; cpu < stbs.num_cpus; cpu++) {
+            if (STBS_FillCpu(group, cpu, macro_cycle[group], stbs.window ? NULL : entry[group][cpu]) != 0) {
+                STBS_FreeTable();
+                return STBS_NotSchedulable(-ENOSPC);
+            }
+        }
+
+        if (stbs.window) {
+            window_seq[group] = k_malloc(stbs.window * sizeof(uint32_t));
+            if (!window_seq[group]) {
+                printk("Failed to allocate scheduler table\n");
+                STBS_FreeTable();
+                return -ENOMEM;
+            }
+            memset(window_seq[group], 0xff, stbs.window * sizeof(uint32_t));
+            // fill the window for the first ticks, before the first release
+            release_seq[group] = UINT32_MAX;
+            filled_seq[group] = 0;
+            fill_tick[group] = 0;
+            for (int cpu = 0; cpu < STBS_MAX_CPUS; cpu++) {
+                held_seq[group][cpu] = 0;
+            }
+            STBS_FillWindow(group, stbs.window - 1);
+        }
+    }
+
+    for (int e = 0; e < num_precedences; e++) {
+        int lag = STBS_GetPrecedenceLag(e);
+        if (lag < 0 || lag > precedences[e].max_lag) {
+            printk("Precedence %s -> %s: lag of %d ticks exceeds the limit of %d\n",
+                stbs.task_table[STBS_FindTask(precedences[e].producer)].name,
+                stbs.task_table[STBS_FindTask(precedences[e].consumer)].name, lag, precedences[e].max_lag);
+            ret = -ENOSPC;
+        }
+    }
+    for (int i = 0; i < stbs.num_tasks; i++) {
+        Task *t = &stbs.task_table[i];
+        if (t->max_jitter >= 0) {
+            int jitter = STBS_GetJitter(t->id);
+            if (jitter > t->max_jitter) {
+                printk("Task %s: start jitter of %d us exceeds the limit of %d us\n", t->name, jitter, t->max_jitter);
+                ret = -ENOSPC;
+            }
+        }
+    }
+    if (ret != 0) {
+        STBS_FreeTable();
+        STBS_NotSchedulable(ret);
+    }
+    return ret;
+}
+
+/**
+ * @brief Tick timer expiry of a group (the timer user data): advances the shared table position
+ * of the group and wakes every dispatcher of the group, so the releases of all the CPUs stay
+ * aligned to the same tick.
+ */
+static void STBS_TickExpired(struct k_timer *timer) {
+    int group = (int)(intptr_t)k_timer_user_data_get(timer);
+
+    if (group == 0) {
+        tick_expiry = k_cycle_get_32();
+    }
+    current_tick[group] = (current_tick[group] + 1) % stbs.groups[group].macro_cycle;
+    release_seq[group]++;
+    for (int cpu = 0; cpu < stbs.num_cpus; cpu++) {
+        k_sem_give(&tick_sem[group][cpu]);
+    }
+    if (stbs.window) {
+        k_sem_give(&filler_sem);    // a slot of the window was freed
+    }
+}
+
+/**
+ * @brief Window filler thread (streaming tables): refills the windows of all the groups
+ * after every tick, in the time left by all the scheduled tasks.
+ */
+static void STBS_Filler(void *argA, void *argB, void *argC) {
+    while (1) {
+        k_sem_take(&filler_sem, K_FOREVER);
+        if (!stbs_running) {
+            break;
+        }
+        for (int group = 0; group < stbs.num_groups; group++) {
+            if (stbs.groups[group].macro_cycle > 0) {
+                STBS_FillWindow(group, stbs.window - 1);
+            }
+        }
+    }
+}
+
+// Run-time statistics of a task (called with stats_lock held)
+static STBS_task_runtime *STBS_FindRuntime(k_tid_t id) {
+    for (int i = 0; i < stbs.num_tasks; i++) {
+        if (runtime[i].id == id) {
+            return &runtime[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Updates the statistics at the start of a tick of group 0 on a CPU: the release latency
+ * of the tick, and the slack left by the previous tick if all its jobs ended.
+ * @param cpu CPU of the dispatcher.
+ * @param now Cycle count of the start of the tick.
+ */
+static void STBS_StatsTick(int cpu, uint32_t now) {
+    uint32_t latency = k_cyc_to_us_floor32(now - tick_expiry);
+    uint32_t tick_us = stbs.groups[0].tick_us;
+
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+    if (cpu == 0) {
+        stats.ticks++;
+    }
+    stats.max_release_latency_us = MAX(stats.max_release_latency_us, latency);
+    min_release_latency_us = MIN(min_release_latency_us, latency);
+    stats.release_jitter_us = stats.max_release_latency_us - min_release_latency_us;
+    if (stbs_running && latency > STBS_LATE_RELEASE_US) {
+        stats.late_releases++;
+    }
+
+    if (cpu_released[cpu] > 0 && cpu_pending[cpu] == 0) {
+        uint32_t busy = k_cyc_to_us_floor32(cpu_last_end[cpu] - cpu_tick_start[cpu]);
+        stats.min_slack_us = MIN(stats.min_slack_us, busy < tick_us ? tick_us - busy : 0);
+    }
+    cpu_tick_start[cpu] = now;
+    cpu_released[cpu] = 0;
+    k_spin_unlock(&stats_lock, key);
+
+    if (stbs_running && latency > STBS_LATE_RELEASE_US && fault_hook) {
+        fault_hook(STBS_FAULT_LATE_RELEASE, -1, latency);
+    }
+}
+
+/**
+ * @brief Updates the statistics of a task when the dispatcher releases it, and reports its overruns.
+ * @param task Entry of the task in the table (its delay_count tells if the job was deferred).
+ * @param now Cycle count of the release.
+ */
+static void STBS_StatsRelease(const Task *task, uint32_t now) {
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+    STBS_task_runtime *r = STBS_FindRuntime(task->id);
+    uint32_t overruns = 0;
+
+    if (r) {
+        r->stats.activations++;
+        if (task->delay_count > 0) {
+            r->stats.deferrals++;
+        }
+        if (r->pending) {
+            overruns = ++r->stats.overruns;     // the resume is lost: the job keeps its first release
+        } else {
+            r->pending = 1;
+            r->release = now;
+            if (r->group == 0) {
+                cpu_pending[r->cpu]++;
+                cpu_released[r->cpu]++;
+            }
+        }
+    }
+    k_spin_unlock(&stats_lock, key);
+
+    if (overruns > 0 && fault_hook) {
+        fault_hook(STBS_FAULT_OVERRUN, r - runtime, overruns);
+    }
+}
+
+/**
+ * @brief Updates the statistics of a task when its job ends.
+ * @param id Task identifier.
+ * @param now Cycle count of the end of the job.
+ */
+static void STBS_StatsEnd(k_tid_t id, uint32_t now) {
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+    STBS_task_runtime *r = runtime ? STBS_FindRuntime(id) : NULL;
+
+    if (r && r->pending) {
+        r->stats.max_response_us = MAX(r->stats.max_response_us, k_cyc_to_us_floor32(now - r->release));
+        r->pending = 0;
+        if (r->group == 0) {
+            cpu_pending[r->cpu]--;
+            cpu_last_end[r->cpu] = now;
+        }
+    }
+    k_spin_unlock(&stats_lock, key);
+}
+
+/**
+ * @brief Dispatcher thread: releases the tasks of every tick of the table of one group and CPU.
+ * It is woken by the periodic tick timer of its group, so the releases do not drift with the
+ * dispatcher's own execution time. The dispatcher of group 0 is cooperative, so all the tasks
+ * of a tick are released before any of them runs; the ones of the slower groups are preemptive,
+ * just above their own tasks (see STBS_GROUP_DISPATCHER_PRIORITY), so they only run when the
+ * faster groups leave time. It is also the executor of the jobs (see STBS_AddJob()), which it
+ * runs to completion while releasing the tick. The tick hook runs on the dispatcher of group 0
+ * and CPU 0, and the scheduler statistics are the ones of group 0.
+ * @param argA CPU of the dispatcher.
+ * @param argB Rate group of the dispatcher.
+ */
+static void STBS_Dispatcher(void *argA, void *argB, void *argC) {
+    int cpu = (int)(intptr_t)argA;
+    int group = (int)(intptr_t)argB;
+    scheduler_table_entry *table = entry[group][cpu];
+    int first = 1;
+    uint32_t last_seq = 0;
+
+    while (1) {
+        k_sem_take(&tick_sem[group][cpu], K_FOREVER);
+        if (!stbs_running) {
+            break;
+        }
+        // read the shared position: if the dispatcher was late, the missed ticks are skipped
+        int tick = current_tick[group];
+        uint32_t seq = release_seq[group];
+        uint32_t now = k_cycle_get_32();
+        scheduler_table_entry *tick_entry;
+
+        if (!first && seq - last_seq > 1) {
+            k_spinlock_key_t key = k_spin_lock(&stats_lock);
+            stats.missed_ticks += seq - last_seq - 1;
+            k_spin_unlock(&stats_lock, key);
+            if (fault_hook) {
+                fault_hook(STBS_FAULT_MISSED_TICK, -1, seq - last_seq - 1);
+            }
+        }
+        last_seq = seq;
+
+        if (stbs.window) {
+            int slot = seq % stbs.window;
+            k_spinlock_key_t key = k_spin_lock(&window_lock);
+            held_seq[group][cpu] = seq;     // the filler does not rewrite the slot until the tick is released
+            int filled = window_seq[group][slot] == seq;
+            k_spin_unlock(&window_lock, key);
+
+            if (!filled) {
+                // the filler is late: fill up to this tick here, so the release is not lost
+                if (STBS_FillWindow(group, 0) > 0) {
+                    key = k_spin_lock(&stats_lock);
+                    stats.window_refills++;
+                    k_spin_unlock(&stats_lock, key);
+                }
+                key = k_spin_lock(&window_lock);
+                filled = window_seq[group][slot] == seq;
+                if (!filled) {
+                    held_seq[group][cpu] = seq + 1;
+                }
+                k_spin_unlock(&window_lock, key);
+                if (!filled) {
+                    continue;       // already refilled for a later tick: this one was missed
+                }
+            }
+            tick_entry = &table[slot];
+        } else {
+            tick_entry = &table[tick];
+        }
+
+#ifdef CONFIG_SCHED_CPU_MASK
+        if (first && stbs.num_cpus > 1) {
+            // the tasks are suspended by now, which is required to change their CPU mask
+            for (int i = 0; i < stbs.num_tasks; i++) {
+                if (stbs.task_table[i].cpu == cpu && stbs.task_table[i].group == group && !stbs.task_table[i].job &&
+                    k_thread_cpu_pin(stbs.task_table[i].id, cpu) != 0) {
+                    printk("Task %s: failed to pin to CPU %d\n", stbs.task_table[i].name, cpu);
+                }
+            }
+        }
+#endif
+        first = 0;
+
+        if (group == 0) {
+            STBS_StatsTick(cpu, now);
+            if (cpu == 0 && tick_hook) {
+                tick_hook(tick);
+            }
+        }
+
+        for(int task_idx = 0; task_idx < tick_entry->num_tasks; task_idx++){
+            Task *task = &tick_entry->tasks[task_idx];
+
+            STBS_StatsRelease(task, now);
+            if (task->job) {
+                // jobs run to completion here; resumed threads only run once the dispatcher waits again
+                task->job(task->job_arg);
+                STBS_StatsEnd(task->id, k_cycle_get_32());
+            } else {
+                k_thread_resume(task->id);
+            }
+        }
+        if (stbs.window) {
+            // the slot is free: the filler can move on to the ticks it was waiting for
+            k_spinlock_key_t key = k_spin_lock(&window_lock);
+            held_seq[group][cpu] = seq + 1;
+            k_spin_unlock(&window_lock, key);
+            k_sem_give(&filler_sem);
+        }
+    }
+}
+
+/**
+ * @brief Schedules all the registered tasks and starts the scheduler.
+ * The tasks are released by a dedicated dispatcher thread per group and CPU, so this function returns.
+ * @return 0 on success, -EALREADY if the scheduler is running, or the error of STBS_BuildTable().
+ */
+int STBS_Start() {
+    if (stbs_running) {
+        return -EALREADY;
+    }
+
+    printk("Starting table computation\n");
+    int ret = STBS_BuildTable();
+    if (ret != 0) {
+        return ret;
+    }
+    if (!STBS_HasTable()) {
+        printk("No tasks to schedule\n");
+        return -EINVAL;
+    }
+    // the timer expires on kernel ticks: a tick in between is rounded up (see CONFIG_SYS_CLOCK_TICKS_PER_SEC)
+    for (int group = 0; group < stbs.num_groups; group++) {
+        int tick_us = stbs.groups[group].tick_us;
+        if (stbs.groups[group].macro_cycle > 0 && k_ticks_to_us_floor64(k_us_to_ticks_ceil64(tick_us)) != (uint64_t)tick_us) {
+            printk("Warning: the %d us tick is not a multiple of the kernel tick, it will last %llu us\n",
+                tick_us, (unsigned long long)k_ticks_to_us_floor64(k_us_to_ticks_ceil64(tick_us)));
+        }
+    }
+    STBS_print_content();
+    STBS_print_slack();
+    STBS_print_overhead();
+    STBS_print_background();
+    STBS_print_precedences();
+    STBS_print_jitter();
+    printk("Starting STBS\n");
+
+    // with equal priorities the tasks of a tick run in the order they are released
+    for (int i = 0; i < stbs.num_tasks; i++) {
+        if (!stbs.task_table[i].job) {
+            k_thread_priority_set(stbs.task_table[i].id, STBS_GROUP_TASK_PRIORITY(stbs.task_table[i].group));
+        }
+    }
+
+    for (int i = 0; i < stbs.num_tasks; i++) {
+        runtime[i].cpu = stbs.task_table[STBS_FindTask(runtime[i].id)].cpu;
+        runtime[i].group = stbs.task_table[STBS_FindTask(runtime[i].id)].group;
+        runtime[i].pending = 0;
+    }
+    for (int cpu = 0; cpu < stbs.num_cpus; cpu++) {
+        cpu_released[cpu] = 0;
+        cpu_pending[cpu] = 0;
+    }
+    STBS_ResetStats();
+
+    stbs_running = 1;
+    for (int group = 0; group < stbs.num_groups; group++) {
+        if (stbs.groups[group].macro_cycle == 0) {
+            continue;
+        }
+        current_tick[group] = -1;      // the first expiry releases tick 0
+        for (int cpu = 0; cpu < stbs.num_cpus; cpu++) {
+            k_thread_stack_t *stack = dispatcher_stack[group * STBS_MAX_CPUS + cpu];
+
+            k_sem_init(&tick_sem[group][cpu], 0, 1);
+            k_thread_create(&dispatcher_thread[group][cpu], stack, K_THREAD_STACK_SIZEOF(dispatcher_stack[0]),
+                            STBS_Dispatcher, (void *)(intptr_t)cpu, (void *)(intptr_t)group, NULL,
+                            STBS_GROUP_DISPATCHER_PRIORITY(group), 0, K_FOREVER);
+#ifdef CONFIG_SCHED_CPU_MASK
+            k_thread_cpu_pin(&dispatcher_thread[group][cpu], cpu);
+#endif
+            k_thread_name_set(&dispatcher_thread[group][cpu], "stbs_dispatcher");
+            k_thread_start(&dispatcher_thread[group][cpu]);
+        }
+        k_timer_init(&tick_timer[group], STBS_TickExpired, NULL);
+        k_timer_user_data_set(&tick_timer[group], (void *)(intptr_t)group);
+    }
+    if (stbs.window) {
+        k_sem_init(&filler_sem, 0, 1);
+        k_thread_create(&filler_thread, filler_stack, K_THREAD_STACK_SIZEOF(filler_stack),
+                        STBS_Filler, NULL, NULL, NULL, STBS_FILLER_PRIORITY, 0, K_NO_WAIT);
+        k_thread_name_set(&filler_thread, "stbs_filler");
+    }
+    // the first tick is delayed to let the tasks arrive at the point where they suspend themselves
+    for (int group = 0; group < stbs.num_groups; group++) {
+        if (stbs.groups[group].macro_cycle > 0) {
+            k_timer_start(&tick_timer[group], K_MSEC(STBS_START_DELAY_MS), K_USEC(stbs.groups[group].tick_us));
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Stops the scheduler. The tasks stay suspended and the table is kept,
+ * so the scheduler can be restarted, or destroyed with STBS_destroy().
+ * Must not be called from a scheduled task.
+ * @return 0 on success, -EALREADY if the scheduler was not running.
+ */
+int STBS_Stop() {
+    if (!stbs_running) {
+        return -EALREADY;
+    }
+    stbs_running = 0;
+    for (int group = 0; group < stbs.num_groups; group++) {
+        if (stbs.groups[group].macro_cycle == 0) {
+            continue;
+        }
+        k_timer_stop(&tick_timer[group]);
+        for (int cpu = 0; cpu < stbs.num_cpus; cpu++) {
+            k_sem_give(&tick_sem[group][cpu]);     // wakes the dispatcher, which then exits
+            k_thread_join(&dispatcher_thread[group][cpu], K_FOREVER);
+        }
+    }
+    if (stbs.window) {
+        k_sem_give(&filler_sem);
+        k_thread_join(&filler_thread, K_FOREVER);
+    }
+    printk("STBS stopped\n");
+    return 0;
+}
+
+/**
+ * @brief Ends the job of the calling task and suspends it until its next release.
+ * Scheduled tasks call it instead of suspending themselves, so that their response
+ * time and overruns are measured.
+ */
+void STBS_WaitRelease(void) {
+    k_tid_t self = k_current_get();
+
+    STBS_StatsEnd(self, k_cycle_get_32());
+    k_thread_suspend(self);
+}
+
+/**
+ * @brief Gets the run-time statistics of a task.
+ * @param task Index of the task, in the order the tasks were added.
+ * @param task_stats Where to store the statistics.
+ * @return 0 on success, -EINVAL if the task does not exist.
+ */
+int STBS_GetTaskStats(int task, STBS_task_stats *task_stats) {
+    if (task < 0 || task >= stbs.num_tasks) {
+        return -EINVAL;
+    }
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+    *task_stats = runtime[task].stats;
+    k_spin_unlock(&stats_lock, key);
+    return 0;
+}
+
+/**
+ * @brief Gets the run-time statistics of the scheduler.
+ * Without CONFIG_SCHED_THREAD_USAGE_ALL the load is the one planned for the busiest CPU (every job
+ * is placed once per period, so it is the load of its tables).
+ * @param sched_stats Where to store the statistics.
+ * @return 0 on success, -ENODATA if the table was not built.
+ */
+int STBS_GetStats(STBS_stats *sched_stats) {
+    if (!STBS_HasTable()) {
+        return -ENODATA;
+    }
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+    *sched_stats = stats;
+    k_spin_unlock(&stats_lock, key);
+
+#ifdef CONFIG_SCHED_THREAD_USAGE_ALL
+    k_thread_runtime_stats_t usage;
+    k_thread_runtime_stats_all_get(&usage);
+    uint64_t cycles = usage.execution_cycles - usage_base.execution_cycles;
+    sched_stats->load = cycles ? ((usage.total_cycles - usage_base.total_cycles) * 1000) / cycles : 0;
+
+    uint64_t background_cycles = 0;
+    for (int i = 0; i < num_background; i++) {
+        k_thread_runtime_stats_t task_usage;
+        k_thread_runtime_stats_get(background[i].id, &task_usage);
+        background_cycles += task_usage.execution_cycles - background[i].usage_base;
+    }
+    sched_stats->background_load = cycles ? (background_cycles * 1000) / cycles : 0;
+#else
+    sched_stats->load = 0;
+    for (int cpu = 0; cpu < stbs.num_cpus; cpu++) {
+        sched_stats->load = MAX(sched_stats->load, STBS_PlannedLoad(cpu));
+    }
+    sched_stats->background_load = 0;
+#endif
+    return 0;
+}
+
+/**
+ * @brief Clears the run-time statistics of the scheduler and of all the tasks.
+ */
+void STBS_ResetStats(void) {
+#ifdef CONFIG_SCHED_THREAD_USAGE_ALL
+    k_thread_runtime_stats_all_get(&usage_base);
+    for (int i = 0; i < num_background; i++) {
+        k_thread_runtime_stats_t task_usage;
+        k_thread_runtime_stats_get(background[i].id, &task_usage);
+        background[i].usage_base = task_usage.execution_cycles;
+    }
+#endif
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+    for (int i = 0; i < stbs.num_tasks; i++) {
+        memset(&runtime[i].stats, 0, sizeof(runtime[i].stats));
+    }
+    memset(&stats, 0, sizeof(stats));
+    stats.min_slack_us = stbs.groups[0].tick_us;
+    min_release_latency_us = UINT32_MAX;
+    k_spin_unlock(&stats_lock, key);
+}
+
+
+// #include <stdio.h> // Needed for snprintf if used
+
+/**
+ * @brief Prints the contents of the scheduler table (only its size if it is streamed in a window).
+ */
+void STBS_print_content() {
+    // Constants for table formatting
+    const char *table_header =  "| Tick | Task Name      | Exec Time (us) | Priority |\n";
+    const char *table_divider = "+------+----------------+----------------+----------+\n";
+
+    // Check for empty scheduler table
+    if (!STBS_HasTable()) {
+        printk("Scheduler table is empty.\n");
+        return;
+    }
+
+    if (stbs.window) {
+        for (int group = 0; group < stbs.num_groups; group++) {
+            if (stbs.groups[group].macro_cycle > 0) {
+                printk("Group %d: macro-cycle of %d ticks, streamed in a window of %d ticks\n",
+                    group, stbs.groups[group].macro_cycle, stbs.window);
+            }
+        }
+        return;
+    }
+
+    printk("Printing scheduler table contents:\n");
+    for (int group = 0; group < stbs.num_groups; group++) {
+        if (stbs.groups[group].macro_cycle == 0) {
+            continue;
+        }
+        if (stbs.num_groups > 1) {
+            printk("Group %d (tick %d us):\n", group, stbs.groups[group].tick_us);
+        }
+        for (int cpu = 0; cpu < stbs.num_cpus; cpu++) {
+            scheduler_table_entry *table = entry[group][cpu];
+
+            if (stbs.num_cpus > 1) {
+                printk("CPU %d:\n", cpu);
+            }
+            printk("%s", table_divider);
+            printk("%s", table_header);
+            printk("%s", table_divider);
+
+            for (int tick = 0; tick < stbs.groups[group].macro_cycle; tick++) {
+                if (table[tick].num_tasks == 0) {
+                    // Print empty tick row
+                    printk("| %4d | %-14s | %-14s | %-8s |\n", tick, "No tasks", "-", "-");
+                    continue;
+                }
+
+                for (int task_idx = 0; task_idx < table[tick].num_tasks; task_idx++) {
+                    Task current_task = table[tick].tasks[task_idx];
+                    
+                    // Print task row
+                    printk("| %4d | %-14s | %-14d | %-8d |\n", 
+                        tick, 
+                        current_task.name, 
+                        current_task.exec_time,  
+                        current_task.priority    
+                    );
+                }
+
+                // Print total execution time row for this tick
+                printk("| %4s | %-14s | %-14d | %-8s |\n", 
+                    "-", 
+                    "Total Time", 
+                    table[tick].total_exec_time, 
+                    "-"
+                );
+                printk("%s", table_divider);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Prints the time left in every tick of the tables, and its minimum and average (whole tables only).
+ * For the slower groups it is the time left of the capacity of their tick (see STBS_GroupCapacity()).
+ */
+void STBS_print_slack() {
+    int min_slack;
+    int total_slack;
+
+    if (!STBS_HasTable() || stbs.window) {
+        printk("Scheduler table is empty or streamed.\n");
+        return;
+    }
+
+    for (int group = 0; group < stbs.num_groups; group++) {
+        int macro_cycle = stbs.groups[group].macro_cycle;
+
+        if (macro_cycle == 0) {
+            continue;
+        }
+        for (int cpu = 0; cpu < stbs.num_cpus; cpu++) {
+            min_slack = STBS_GroupCapacity(group, cpu, NULL);
+            total_slack = 0;
+            if (stbs.num_groups > 1) {
+                printk("Group %d ", group);
+            }
+            printk("CPU %d slack per tick (us):", cpu);
+            for (int tick = 0; tick < macro_cycle; tick++) {
+                int slack = STBS_GetGroupTickSlack(group, cpu, tick);
+                printk(" %d", slack);
+                total_slack += slack;
+                if (slack < min_slack) {
+                    min_slack = slack;
+                }
+            }
+            printk("\nMinimum slack: %d us, average slack: %d us\n", min_slack, total_slack / macro_cycle);
+        }
+    }
+}
+
+/**
+ * @brief Prints the dispatcher overheads and the time of every tick left to the tasks.
+ */
+void STBS_print_overhead() {
+    printk("Dispatcher overhead: %d us per tick, %d us per release\n", overhead.tick_us, overhead.release_us);
+    for (int group = 0; group < stbs.num_groups; group++) {
+        if (stbs.groups[group].macro_cycle == 0) {
+            continue;
+        }
+        for (int cpu = 0; cpu < stbs.num_cpus; cpu++) {
+            printk("Group %d CPU %d: %d us of the %d us tick usable by the tasks\n", group, cpu,
+                STBS_GroupCapacity(group, cpu, NULL) - STBS_TickOverhead(group), stbs.groups[group].tick_us);
+        }
+    }
+}
+
+/**
+ * @brief Prints the background tasks and the share of the CPUs the tables leave to them.
+ */
+void STBS_print_background() {
+    if (num_background == 0 || !STBS_HasTable()) {
+        return;
+    }
+    int budget = STBS_GetBackgroundBudget();
+    printk("Background lane: %d.%d%% of the CPUs left idle by the tables for", budget / 10, budget % 10);
+    for (int i = 0; i < num_background; i++) {
+        printk(" %s (level %d)", background[i].name, background[i].level);
+    }
+    printk("\n");
+}
+
+/**
+ * @brief Prints the worst-case lag of every precedence edge in the table.
+ */
+void STBS_print_precedences() {
+    for (int e = 0; e < num_precedences && STBS_HasTable() && !stbs.window; e++) {
+        printk("Precedence %s -> %s: worst lag %d ticks (limit %d)\n",
+            stbs.task_table[STBS_FindTask(precedences[e].producer)].name,
+            stbs.task_table[STBS_FindTask(precedences[e].consumer)].name,
+            STBS_GetPrecedenceLag(e), precedences[e].max_lag);
+    }
+}
+
+/**
+ * @brief Prints the start-time jitter of every task in the table.
+ */
+void STBS_print_jitter() {
+    if (!STBS_HasTable() || stbs.window) {
+        return;
+    }
+    printk("Start jitter (us):");
+    for (int i = 0; i < stbs.num_tasks; i++) {
+        printk(" %s %d", stbs.task_table[i].name, STBS_GetJitter(stbs.task_table[i].id));
+        if (stbs.task_table[i].max_jitter >= 0) {
+            printk(" (limit %d)", stbs.task_table[i].max_jitter);
+        }
+    }
+    printk("\n");
+}
+
+/**
+ * @brief Stops the scheduler if it is running and frees the table and the tasks.
+ * STBS_Init() must be called again before adding new tasks.
+ */
+void STBS_destroy(){
+    STBS_Stop();
+    STBS_FreeTable();
+
+     // Free the task table and reset fields
+    if (stbs.task_table) {
+        k_free(stbs.task_table);
+        stbs.task_table = NULL;
+    }
+    k_free(runtime);
+    runtime = NULL;
+    stbs.num_tasks = 0;
+    stbs.num_groups = 1;
+    num_precedences = 0;
+    num_background = 0;
+}
+
+
+// testing functions
+int STBS_GetNumTasks(void) {
+    return stbs.num_tasks;
+}
+
+int STBS_GetTickUs(void) {
+    return stbs.groups[0].tick_us;
+}
+
+const Task* STBS_GetTaskTable(void) {
+    return stbs.task_table;
+}
+
+int STBS_GetMacroCycle(void) {
+    return stbs.groups[0].macro_cycle;
+}
+
+// Time left in a tick of the table of a CPU, in us (errors as STBS_GetGroupTickSlack())
+int STBS_GetTickSlack(int cpu, int tick) {
+    return STBS_GetGroupTickSlack(0, cpu, tick);
+}
+
+int STBS_GetNumCpus(void) {
+    return stbs.num_cpus;
+}
+
+int STBS_GetNumGroups(void) {
+    return stbs.num_groups;
+}
+
+int STBS_GetGroupTickUs(int group) {
+    return stbs.groups[group].tick_us;
+}
+
+int STBS_GetGroupMacroCycle(int group) {
+    return stbs.groups[group].macro_cycle;
+}
+
+// Time of every tick of a group that its tasks can use on a CPU, in us
+int STBS_GetGroupCapacity(int group, int cpu) {
+    return STBS_GroupCapacity(group, cpu, NULL);
+}
+
+// Time left of the capacity of a tick of the table of a group and CPU, in us
+// (-EINVAL if out of range, -ENODATA if the table is not built or is streamed)
+int STBS_GetGroupTickSlack(int group, int cpu, int tick) {
+    if (group < 0 || group >= stbs.num_groups || cpu < 0 || cpu >= stbs.num_cpus) {
+        return -EINVAL;
+    }
+    if (stbs.groups[group].macro_cycle == 0 || !entry[group][cpu] || stbs.window) {
+        return -ENODATA;
+    }
+    if (tick < 0 || tick >= stbs.groups[group].macro_cycle) {
+        return -EINVAL;
+    }
+    return STBS_GroupCapacity(group, cpu, NULL) - entry[group][cpu][tick].total_exec_time;
+}
+
+/**
+ * @brief Gets the tasks a dispatcher releases in a tick, with the ticks they were deferred
+ * (Task.delay_count). With a window the ticks are streamed through it as when the scheduler
+ * runs, so they can only be read in order while the scheduler is stopped; STBS_BuildTable()
+ * starts them again from the first release.
+ * @param group Rate group.
+ * @param cpu CPU of the table.
+ * @param seq Tick counted from the first release; its position in the table is seq modulo the macro-cycle.
+ * @param tasks Where to store the entries of the tasks, in the order they are released.
+ * @param max Maximum number of entries to store.
+ * @return Number of tasks released in the tick, -EINVAL if the group or the CPU is invalid,
+ *         -ENODATA if the table was not built or the tick already left the window,
+ *         -EBUSY if the window is in use by the scheduler.
+ */
+int STBS_GetTickTasks(int group, int cpu, uint32_t seq, Task *tasks, int max) {
+    scheduler_table_entry *tick_entry;
+
+    if (group < 0 || group >= stbs.num_groups || cpu < 0 || cpu >= stbs.num_cpus || max < 0) {
+        return -EINVAL;
+    }
+    if (stbs.groups[group].macro_cycle == 0 || !entry[group][cpu]) {
+        return -ENODATA;
+    }
+    if (!stbs.window) {
+        tick_entry = &entry[group][cpu][seq % stbs.groups[group].macro_cycle];
+    } else {
+        if (stbs_running) {
+            return -EBUSY;
+        }
+        k_spinlock_key_t key = k_spin_lock(&window_lock);
+        if ((int32_t)(seq - release_seq[group]) > 0) {
+            // released as by the dispatchers: the ring moves on to the tick
+            release_seq[group] = seq;
+            for (int c = 0; c < stbs.num_cpus; c++) {
+                held_seq[group][c] = seq;
+            }
+            while ((int32_t)(filled_seq[group] - seq) <= 0) {
+                STBS_FillWindowTick(group);
+            }
+        }
+        int held = window_seq[group][seq % stbs.window] == seq;
+        k_spin_unlock(&window_lock, key);
+        if (!held) {
+            return -ENODATA;
+        }
+        tick_entry = &entry[group][cpu][seq % stbs.window];
+    }
+    if (tick_entry->num_tasks > 0) {
+        memcpy(tasks, tick_entry->tasks, MIN(tick_entry->num_tasks, max) * sizeof(Task));
+    }
+    return tick_entry->num_tasks;
+}
+
+// Bytes used by the scheduler tables of all the groups (0 if they were not built)
+int STBS_GetTableBytes(void) {
+    int bytes = 0;
+
+    for (int group = 0; group < stbs.num_groups; group++) {
+        int group_tasks = 0;
+        for (int i = 0; i < stbs.num_tasks; i++) {
+            group_tasks += stbs.task_table[i].group == group;
+        }
+        if (stbs.groups[group].macro_cycle > 0) {
+            bytes += STBS_TableLength(group) * (stbs.num_cpus * sizeof(scheduler_table_entry) + group_tasks * sizeof(Task));
+            bytes += window_seq[group] ? stbs.window * sizeof(uint32_t) : 0;
+        }
+    }
+    return bytes;
+}
+
+/**
+ * @brief Finds the latest job of a task that completes before a given job starts.
+ * Jobs on the same CPU and tick complete in table order; jobs on other CPUs run in
+ * parallel, so only the ones of the previous ticks are seen.
+ * @param producer Index of the task whose job is searched.
+ * @param cpu CPU of the job that reads the output.
+ * @param tick Tick of that job (may be negative: a previous macro-cycle).
+ * @param pos Position of that job in its tick.
+ * @param prod_tick Where to store the tick of the job found (may be before tick 0).
+ * @param prod_pos Where to store its position in that tick.
+ * @return 0 on success, -ENOENT if the task has no job in the table.
+ */
+static int STBS_FindProducerJob(int producer, int cpu, int tick, int pos, int *prod_tick, int *prod_pos) {
+    const Task *p = &stbs.task_table[producer];
+    int macro_cycle = stbs.groups[p->group].macro_cycle;
+
+    for (int back = 0; back <= macro_cycle; back++) {
+        int t = tick - back;
+        scheduler_table_entry *e = &entry[p->group][p->cpu][((t % macro_cycle) + macro_cycle) % macro_cycle];
+        int limit = e->num_tasks;
+
+        if (back == 0) {
+            limit = p->cpu == cpu ? pos : 0;
+        }
+        for (int k = limit - 1; k >= 0; k--) {
+            if (e->tasks[k].id == p->id) {
+                *prod_tick = t;
+                *prod_pos = k;
+                return 0;
+            }
+        }
+    }
+    return -ENOENT;
+}
+
+// Start of a job in its tick, in us, with the tasks of the tick running back to back after the dispatcher
+static int STBS_JobStart(int group, int cpu, int tick, int pos) {
+    int macro_cycle = stbs.groups[group].macro_cycle;
+    scheduler_table_entry *e = &entry[group][cpu][((tick % macro_cycle) + macro_cycle) % macro_cycle];
+    int start = STBS_TickOverhead(group) + overhead.release_us;
+
+    for (int k = 0; k < pos; k++) {
+        start += STBS_Cost(&e->tasks[k]);
+    }
+    return start;
+}
+
+// Worst-case lag of a precedence edge in the table, in ticks (negative error if there is no whole table)
+int STBS_GetPrecedenceLag(int edge) {
+    int producer, consumer, worst = 0;
+
+    if (edge < 0 || edge >= num_precedences) {
+        return -EINVAL;
+    }
+    producer = STBS_FindTask(precedences[edge].producer);
+    consumer = STBS_FindTask(precedences[edge].consumer);
+    if (producer < 0 || consumer < 0 || stbs.task_table[producer].group != stbs.task_table[consumer].group) {
+        return -EINVAL;
+    }
+    int group = stbs.task_table[consumer].group;
+    if (stbs.groups[group].macro_cycle == 0 || stbs.window) {
+        return -ENODATA;
+    }
+
+    int cpu = stbs.task_table[consumer].cpu;
+    scheduler_table_entry *table = entry[group][cpu];
+    for (int tick = 0; tick < stbs.groups[group].macro_cycle; tick++) {
+        for (int k = 0; k < table[tick].num_tasks; k++) {
+            int prod_tick, prod_pos;
+
+            if (table[tick].tasks[k].id != precedences[edge].consumer) {
+                continue;
+            }
+            if (STBS_FindProducerJob(producer, cpu, tick, k, &prod_tick, &prod_pos) != 0) {
+                return -ENOENT;
+            }
+            worst = MAX(worst, tick - prod_tick);
+        }
+    }
+    return worst;
+}
+
+/**
+ * @brief Computes the worst-case end-to-end latency of a chain of tasks in the table.
+ * For every job of the last task, the chain is followed backwards through the latest job of
+ * each task that completes before the job of the next one starts. The latency goes from the
+ * start of the job of the first task to the end of the job of the last one, assuming the
+ * tasks of a tick run back to back for their execution time from the start of the tick
+ * (for the slower groups, without the preemptions by the faster ones).
+ * @param chain Tasks of the chain, from the first producer to the last consumer.
+ * @param length Number of tasks in the chain.
+ * @return Worst-case latency in us, -EINVAL if a task is not registered or the tasks are in
+ *         different rate groups, -ENODATA if the table was not built or is streamed.
+ */
+int STBS_GetChainLatency(const k_tid_t *chain, int length) {
+    int index[length > 0 ? length : 1];
+    int worst = 0;
+
+    if (length <= 0) {
+        return -EINVAL;
+    }
+    for (int i = 0; i < length; i++) {
+        index[i] = STBS_FindTask(chain[i]);
+        if (index[i] < 0 || stbs.task_table[index[i]].group != stbs.task_table[index[0]].group) {
+            return -EINVAL;
+        }
+    }
+    int group = stbs.task_table[index[0]].group;
+    int tick_us = stbs.groups[group].tick_us;
+    if (stbs.groups[group].macro_cycle == 0 || stbs.window) {
+        return -ENODATA;
+    }
+
+    int last_cpu = stbs.task_table[index[length - 1]].cpu;
+    scheduler_table_entry *table = entry[group][last_cpu];
+    for (int tick = 0; tick < stbs.groups[group].macro_cycle; tick++) {
+        for (int k = 0; k < table[tick].num_tasks; k++) {
+            int cpu = last_cpu, t = tick, pos = k;
+
+            if (table[tick].tasks[k].id != chain[length - 1]) {
+                continue;
+            }
+            int end = tick * tick_us + STBS_JobStart(group, cpu, tick, k) + table[tick].tasks[k].exec_time;
+
+            for (int i = length - 2; i >= 0; i--) {
+                if (STBS_FindProducerJob(index[i], cpu, t, pos, &t, &pos) != 0) {
+                    return -ENOENT;
+                }
+                cpu = stbs.task_table[index[i]].cpu;
+            }
+            worst = MAX(worst, end - (t * tick_us + STBS_JobStart(group, cpu, t, pos)));
+        }
+    }
+    return worst;
+}
+
+/**
+ * @brief Computes the start-time jitter of a task in the table: the spread of the time from
+ * the release of each of its jobs to its start, assuming the tasks of a tick run back to back
+ * for their execution time (for the slower groups, without the preemptions by the faster ones).
+ * A deferred job is released in the tick of its period.
+ * @param task Task identifier.
+ * @return Jitter in us, -EINVAL if the task is not registered, -ENODATA if the table was not built or is streamed.
+ */
+int STBS_GetJitter(k_tid_t task) {
+    int i = STBS_FindTask(task);
+    int min_start = INT_MAX, max_start = 0;
+
+    if (i < 0) {
+        return -EINVAL;
+    }
+    int group = stbs.task_table[i].group;
+    if (stbs.groups[group].macro_cycle == 0 || stbs.window) {
+        return -ENODATA;
+    }
+
+    int cpu = stbs.task_table[i].cpu;
+    scheduler_table_entry *table = entry[group][cpu];
+    for (int tick = 0; tick < stbs.groups[group].macro_cycle; tick++) {
+        for (int k = 0; k < table[tick].num_tasks; k++) {
+            if (table[tick].tasks[k].id == task) {
+                int start = table[tick].tasks[k].delay_count * stbs.groups[group].tick_us + STBS_JobStart(group, cpu, tick, k);
+                min_start = MIN(min_start, start);
+                max_start = MAX(max_start, start);
+            }
+        }
+    }
+    return min_start == INT_MAX ? 0 : max_start - min_start;
+}
+
+/**
+ * @brief Time the tables leave idle for the background lane: what the planned load of the
+ * scheduled tasks and the dispatcher overheads leaves of all the CPUs of the system.
+ * @return Idle time in per-mille of all the CPUs (comparable to STBS_stats.background_load),
+ *         or -ENODATA if the table was not built.
+ */
+int STBS_GetBackgroundBudget(void) {
+    if (!STBS_HasTable()) {
+        return -ENODATA;
+    }
+    int num_cpus = arch_num_cpus();
+    int64_t idle = (int64_t)num_cpus * 1000;
+
+    for (int cpu = 0; cpu < stbs.num_cpus; cpu++) {
+        idle -= MIN(STBS_PlannedLoad(cpu), 1000u);
+    }
+    return idle / num_cpus;
+}
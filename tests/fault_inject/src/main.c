@@ -0,0 +1,204 @@
+/**
+ * @file
+ * @brief Fault injection accounting tests
+ *
+ * Drives the injection hooks as the application does (tick boundaries, frames, jobs and the
+ * timing faults reported by the scheduler), with every fault injected at the first opportunity,
+ * and checks what is counted for each kind: an injection detected and then recovered, one never
+ * detected and masked after FAULT_INJECT_TIMEOUT_TICKS, the tick boundaries to its detection and
+ * recovery, and the latency probes. Only one injection of a kind is followed at a time.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+
+#include "../../../include/fault_inject.h"
+#include "../../../include/rtdb.h"
+#include "../../../include/latency.h"
+
+static RT_db rtdb;
+
+// Field holding the corrupted value, or -1
+static int corrupted_field(void) {
+    for (int field = 0; field < RTDB_NUM_FIELDS; field++) {
+        int value = *RT_db_field(RT_db_in(), field);
+        if (value != 0 && value != 1) {
+            return field;
+        }
+    }
+    return -1;
+}
+
+static void check_stats(int kind, uint32_t injected, uint32_t detected, uint32_t masked, uint32_t recovered) {
+    fault_inject_stats stats;
+
+    zassert_ok(fault_inject_get_stats(kind, &stats));
+    zassert_equal(stats.injected, injected, "kind %d: %u injected", kind, stats.injected);
+    zassert_equal(stats.detected, detected, "kind %d: %u detected", kind, stats.detected);
+    zassert_equal(stats.masked, masked, "kind %d: %u masked", kind, stats.masked);
+    zassert_equal(stats.recovered, recovered, "kind %d: %u recovered", kind, stats.recovered);
+}
+
+static uint32_t probe_count(int probe) {
+    latency_summary summary;
+
+    zassert_ok(latency_get_summary(probe, &summary));
+    return summary.count;
+}
+
+ZTEST(fault_inject, test_rates)
+{
+    zassert_equal(fault_inject_set_rate(-1, 0), -EINVAL);
+    zassert_equal(fault_inject_set_rate(FAULT_INJECT_NUM_KINDS, 0), -EINVAL);
+    zassert_equal(fault_inject_set_rate(FAULT_INJECT_RTDB, -1), -EINVAL);
+    zassert_equal(fault_inject_set_rate(FAULT_INJECT_RTDB, 1001), -EINVAL);
+    zassert_equal(fault_inject_get_rate(FAULT_INJECT_NUM_KINDS), -EINVAL);
+
+    zassert_ok(fault_inject_set_rate(FAULT_INJECT_FRAME, 250));
+    zassert_equal(fault_inject_get_rate(FAULT_INJECT_FRAME), 250);
+
+    // disabled: nothing is injected
+    for (int i = 0; i < 10; i++) {
+        fault_inject_tick();
+    }
+    zassert_equal(corrupted_field(), -1);
+    check_stats(FAULT_INJECT_RTDB, 0, 0, 0, 0);
+}
+
+ZTEST(fault_inject, test_rtdb_recovered)
+{
+    zassert_ok(fault_inject_set_rate(FAULT_INJECT_RTDB, 1000));
+    fault_inject_tick();
+    zassert_ok(fault_inject_set_rate(FAULT_INJECT_RTDB, 0));
+    int field = corrupted_field();
+    zassert_true(field >= 0, "no value corrupted");
+    check_stats(FAULT_INJECT_RTDB, 1, 0, 0, 0);
+
+    // job2 finds it in the same tick and repairs it: recovered when the next tick reads it valid
+    fault_inject_detected(FAULT_INJECT_RTDB);
+    fault_inject_detected(FAULT_INJECT_RTDB);
+    check_stats(FAULT_INJECT_RTDB, 1, 1, 0, 0);
+    fault_inject_tick();
+    check_stats(FAULT_INJECT_RTDB, 1, 1, 0, 0);
+    *RT_db_field(RT_db_out(), field) = 0;
+    fault_inject_tick();
+    check_stats(FAULT_INJECT_RTDB, 1, 1, 0, 1);
+
+    fault_inject_stats stats;
+    zassert_ok(fault_inject_get_stats(FAULT_INJECT_RTDB, &stats));
+    zassert_equal(stats.max_detection_ticks, 0);
+    zassert_equal(stats.max_recovery_ticks, 2);
+    zassert_equal(probe_count(LATENCY_FAULT_DETECTION), 1);
+    zassert_equal(probe_count(LATENCY_FAULT_RECOVERY), 1);
+}
+
+ZTEST(fault_inject, test_rtdb_masked)
+{
+    zassert_ok(fault_inject_set_rate(FAULT_INJECT_RTDB, 1000));
+    fault_inject_tick();
+    zassert_ok(fault_inject_set_rate(FAULT_INJECT_RTDB, 0));
+    zassert_true(corrupted_field() >= 0, "no value corrupted");
+
+    // never detected: masked once FAULT_INJECT_TIMEOUT_TICKS have passed, not before
+    for (int i = 0; i < FAULT_INJECT_TIMEOUT_TICKS; i++) {
+        fault_inject_tick();
+    }
+    check_stats(FAULT_INJECT_RTDB, 1, 0, 0, 0);
+    fault_inject_tick();
+    check_stats(FAULT_INJECT_RTDB, 1, 0, 1, 0);
+
+    // a late detection is not counted, and a new injection is followed again
+    fault_inject_detected(FAULT_INJECT_RTDB);
+    zassert_ok(fault_inject_set_rate(FAULT_INJECT_RTDB, 1000));
+    fault_inject_tick();
+    check_stats(FAULT_INJECT_RTDB, 2, 0, 1, 0);
+    zassert_equal(probe_count(LATENCY_FAULT_DETECTION), 0);
+}
+
+ZTEST(fault_inject, test_frame)
+{
+    static const char sent[] = "!1O11123#";
+    char frame[sizeof(sent)];
+
+    zassert_ok(fault_inject_set_rate(FAULT_INJECT_FRAME, 1000));
+
+    // a single bit flipped, then the frame rejected: detected and recovered at once
+    memcpy(frame, sent, sizeof(sent));
+    zassert_equal(fault_inject_frame(frame, sizeof(sent) - 1), 1);
+    int flipped = 0;
+    for (int i = 0; i < sizeof(sent); i++) {
+        flipped += __builtin_popcount((uint8_t)(frame[i] ^ sent[i]));
+    }
+    zassert_equal(flipped, 1, "%d bits flipped", flipped);
+    fault_inject_frame_checked(1);
+    check_stats(FAULT_INJECT_FRAME, 1, 1, 0, 1);
+
+    // accepted: masked
+    zassert_equal(fault_inject_frame(frame, sizeof(sent) - 1), 1);
+    fault_inject_frame_checked(0);
+    check_stats(FAULT_INJECT_FRAME, 2, 1, 1, 1);
+
+    // an empty frame has nothing to corrupt
+    zassert_equal(fault_inject_frame(frame, 0), 0);
+    check_stats(FAULT_INJECT_FRAME, 2, 1, 1, 1);
+}
+
+ZTEST(fault_inject, test_timing)
+{
+    // a fault reported without an injection is not counted
+    fault_inject_timing_fault();
+    fault_inject_tick();
+    check_stats(FAULT_INJECT_EXEC, 0, 0, 0, 0);
+
+    zassert_ok(fault_inject_set_rate(FAULT_INJECT_EXEC, 1000));
+    fault_inject_exec();
+    zassert_ok(fault_inject_set_rate(FAULT_INJECT_EXEC, 0));
+    check_stats(FAULT_INJECT_EXEC, 1, 0, 0, 0);
+
+    // the scheduler reports the overrun, and then a missed tick at the next boundary:
+    // recovered at the first boundary after them without a new fault
+    fault_inject_timing_fault();
+    fault_inject_tick();
+    fault_inject_timing_fault();
+    fault_inject_tick();
+    check_stats(FAULT_INJECT_EXEC, 1, 1, 0, 0);
+    fault_inject_tick();
+    check_stats(FAULT_INJECT_EXEC, 1, 1, 0, 1);
+
+    fault_inject_stats stats;
+    zassert_ok(fault_inject_get_stats(FAULT_INJECT_EXEC, &stats));
+    zassert_equal(stats.max_detection_ticks, 0);
+    zassert_equal(stats.max_recovery_ticks, 3);
+    check_stats(FAULT_INJECT_DELAY, 0, 0, 0, 0);
+
+    // a longer job the schedule absorbs is never reported: masked, not recovered
+    zassert_ok(fault_inject_set_rate(FAULT_INJECT_EXEC, 1000));
+    fault_inject_exec();
+    zassert_ok(fault_inject_set_rate(FAULT_INJECT_EXEC, 0));
+    for (int i = 0; i <= FAULT_INJECT_TIMEOUT_TICKS; i++) {
+        fault_inject_tick();
+    }
+    check_stats(FAULT_INJECT_EXEC, 2, 1, 1, 1);
+
+    // the statistics are cleared
+    fault_inject_reset_stats();
+    check_stats(FAULT_INJECT_EXEC, 0, 0, 0, 0);
+}
+
+static void *fault_inject_setup(void) {
+    RT_db_init(&rtdb);
+    RT_db_let_init(&rtdb, 0);
+    return NULL;
+}
+
+static void fault_inject_before(void *fixture) {
+    for (int kind = 0; kind < FAULT_INJECT_NUM_KINDS; kind++) {
+        zassert_ok(fault_inject_set_rate(kind, 0));
+    }
+    fault_inject_tick();        // forgets the timing faults of the previous test
+    fault_inject_reset_stats();
+    latency_reset(-1);
+    RT_db_init(&rtdb);
+}
+
+ZTEST_SUITE(fault_inject, NULL, fault_inject_setup, fault_inject_before, NULL, NULL);
@@ -0,0 +1,153 @@
+/**
+ * @file
+ * @brief Persistent fault log tests
+ *
+ * Records events in the log kept in the flash simulator of native_sim, and checks that
+ * they are written in batches, read back in order without the padding of the flash writes
+ * (16-byte write block, see boards/native_sim.overlay), the newest ones when they do not all
+ * fit, kept when the log is opened again as after a reset, counted when the queue
+ * overflows, and erased by a clear. A partition that holds something else is not taken over:
+ * the events are then kept in RAM.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+#include <zephyr/storage/flash_map.h>
+
+#include "../../../include/fault_log.h"
+#include "../../../include/rtdb.h"
+
+#define TEST_MAX_EVENTS 40
+
+static fault_log_entry events[TEST_MAX_EVENTS];
+
+static void record_overruns(int count) {
+    for (int i = 0; i < count; i++) {
+        fault_log_record(FAULT_LOG_OVERRUN, i % 4, i);
+    }
+}
+
+static void *fault_log_setup(void) {
+    zassert_ok(fault_log_init());
+    return NULL;
+}
+
+static void fault_log_before(void *fixture) {
+    fault_log_flush();
+    zassert_ok(fault_log_clear());
+}
+
+ZTEST(fault_log, test_record_read)
+{
+    uint32_t total;
+
+    fault_log_record(FAULT_LOG_OVERRUN, 2, 7);
+    fault_log_record(FAULT_LOG_CORRUPTED, RTDB_LED0, -1);
+    fault_log_record(FAULT_LOG_NOT_SCHEDULABLE, -1, -ENOSPC);
+    zassert_equal(fault_log_read(events, TEST_MAX_EVENTS, &total), 0, "events are written in batches");
+
+    // 36 bytes, padded to 48 in flash: still 3 events
+    zassert_ok(fault_log_flush());
+    zassert_equal(fault_log_read(events, TEST_MAX_EVENTS, &total), 3);
+    zassert_equal(total, 3);
+    zassert_equal(events[0].event, FAULT_LOG_OVERRUN);
+    zassert_equal(events[0].source, 2);
+    zassert_equal(events[0].value, 7);
+    zassert_equal(events[1].event, FAULT_LOG_CORRUPTED);
+    zassert_equal(events[1].source, RTDB_LED0);
+    zassert_equal(events[1].value, -1);
+    zassert_equal(events[2].event, FAULT_LOG_NOT_SCHEDULABLE);
+    zassert_equal(events[2].value, -ENOSPC);
+    zassert_true(events[0].uptime_ms <= events[2].uptime_ms);
+    zassert_equal(events[0].boot, events[2].boot);
+    zassert_equal(fault_log_read(events, -1, NULL), -EINVAL);
+}
+
+ZTEST(fault_log, test_newest_events)
+{
+    uint32_t total;
+
+    // more than a batch: two flash entries
+    record_overruns(FAULT_LOG_BATCH_SIZE + 4);
+    zassert_ok(fault_log_flush());
+
+    zassert_equal(fault_log_read(events, 5, &total), 5);
+    zassert_equal(total, FAULT_LOG_BATCH_SIZE + 4);
+    for (int i = 0; i < 5; i++) {
+        zassert_equal(events[i].value, FAULT_LOG_BATCH_SIZE - 1 + i, "newest events, oldest first");
+    }
+}
+
+ZTEST(fault_log, test_reopen)
+{
+    uint32_t total;
+
+    record_overruns(2);
+    zassert_ok(fault_log_flush());
+    zassert_equal(fault_log_read(events, TEST_MAX_EVENTS, &total), 2);
+    int first_boot = events[0].boot;
+
+    // as after a reset: the events are kept, and the new ones belong to the next boot
+    zassert_ok(fault_log_init());
+    zassert_equal(fault_log_read(events, TEST_MAX_EVENTS, &total), 2);
+    record_overruns(1);
+    zassert_ok(fault_log_flush());
+    zassert_equal(fault_log_read(events, TEST_MAX_EVENTS, &total), 3);
+    zassert_equal(events[2].boot, first_boot + 1);
+}
+
+ZTEST(fault_log, test_dropped)
+{
+    uint32_t total;
+
+    // nothing is written while recording, so the queue overflows
+    record_overruns(FAULT_LOG_QUEUE_SIZE + 4);
+    zassert_ok(fault_log_flush());
+
+    zassert_equal(fault_log_read(events, TEST_MAX_EVENTS, &total), FAULT_LOG_QUEUE_SIZE + 1);
+    zassert_equal(events[FAULT_LOG_QUEUE_SIZE].event, FAULT_LOG_DROPPED);
+    zassert_equal(events[FAULT_LOG_QUEUE_SIZE].value, 4);
+}
+
+ZTEST(fault_log, test_clear)
+{
+    uint32_t total;
+
+    record_overruns(3);
+    zassert_ok(fault_log_flush());
+    zassert_ok(fault_log_clear());
+    zassert_equal(fault_log_read(events, TEST_MAX_EVENTS, &total), 0);
+    zassert_equal(total, 0);
+}
+
+ZTEST(fault_log, test_foreign_partition)
+{
+    static const uint8_t foreign[16] = "settings data";
+    uint8_t data[sizeof(foreign)];
+    const struct flash_area *fa;
+
+    // as a partition that held something else before the log
+    zassert_ok(flash_area_open(FIXED_PARTITION_ID(fault_log_partition), &fa));
+    zassert_ok(flash_area_erase(fa, 0, fa->fa_size));
+    zassert_ok(flash_area_write(fa, 0, foreign, sizeof(foreign)));
+
+    zassert_equal(fault_log_init(), -ENOMSG, "the partition does not hold a log");
+    zassert_ok(flash_area_read(fa, 0, data, sizeof(data)));
+    zassert_mem_equal(data, foreign, sizeof(foreign), "the partition was erased");
+
+    // the log still works, in RAM
+    uint32_t total;
+    record_overruns(2);
+    zassert_ok(fault_log_flush());
+    zassert_equal(fault_log_read(events, TEST_MAX_EVENTS, &total), 2);
+    zassert_equal(events[1].value, 1);
+    zassert_ok(flash_area_read(fa, 0, data, sizeof(data)));
+    zassert_mem_equal(data, foreign, sizeof(foreign), "the RAM log wrote the partition");
+
+    // the next tests get an empty log
+    zassert_ok(flash_area_erase(fa, 0, fa->fa_size));
+    flash_area_close(fa);
+    zassert_ok(fault_log_init());
+}
+
+ZTEST_SUITE(fault_log, NULL, fault_log_setup, fault_log_before, NULL, NULL);
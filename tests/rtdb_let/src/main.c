@@ -0,0 +1,84 @@
+/**
+ * @file
+ * @brief RTDB logical-execution-time (LET) tests
+ *
+ * Runs the RTDB as the tick boundaries of the application do in LET mode: the outputs written
+ * during a tick are published at the next swap, and the inputs latched at a boundary are read
+ * during the whole tick that starts there.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+
+#include "../../../include/rtdb.h"
+
+static RT_db rtdb;
+
+ZTEST(rtdb_let, test_disabled)
+{
+    RT_db_let_init(&rtdb, 0);
+    zassert_false(RT_db_let_enabled());
+    zassert_equal_ptr(RT_db_in(), &rtdb);
+    zassert_equal_ptr(RT_db_out(), &rtdb);
+
+    // everything is seen at once
+    RT_db_toggle_led(RT_db_out(), 1);
+    RT_db_let_latch_button(2, 1);
+    zassert_equal(RT_db_in()->led1, 1);
+    zassert_equal(RT_db_in()->button2, 1);
+    zassert_equal_ptr(RT_db_let_swap(), &rtdb);
+}
+
+ZTEST(rtdb_let, test_outputs_published_at_swap)
+{
+    RT_db_let_init(&rtdb, 1);
+    zassert_true(RT_db_let_enabled());
+    zassert_not_equal(RT_db_in(), RT_db_out());
+
+    RT_db_toggle_led(RT_db_out(), 0);
+    zassert_equal(RT_db_in()->led0, 0, "written before the boundary");
+
+    RT_db *in = RT_db_let_swap();
+    zassert_equal_ptr(in, RT_db_in());
+    zassert_equal(in->led0, 1);
+    // the new shadow starts as a copy of the published tick
+    zassert_equal(RT_db_out()->led0, 1);
+    RT_db_toggle_led(RT_db_out(), 0);
+    zassert_equal(RT_db_in()->led0, 1);
+    RT_db_let_swap();
+    zassert_equal(RT_db_in()->led0, 0);
+}
+
+ZTEST(rtdb_let, test_inputs_latched_at_boundary)
+{
+    RT_db_let_init(&rtdb, 1);
+
+    // a press latched at the boundary is read during the whole tick...
+    RT_db_let_swap();
+    RT_db_let_latch_button(3, 1);
+    zassert_equal(RT_db_in()->button3, 1);
+
+    // ...alongside what the tasks write in it, and it stays after the next swap
+    RT_db_toggle_led(RT_db_out(), 3);
+    RT_db_let_swap();
+    zassert_equal(RT_db_in()->button3, 1);
+    zassert_equal(RT_db_in()->led3, 1);
+
+    // a task writing a button does not change what the others read in the tick
+    RT_db_set_button(RT_db_out(), 3, 0);
+    zassert_equal(RT_db_in()->button3, 1);
+
+    // the release latched at the next boundary
+    RT_db_let_swap();
+    RT_db_let_latch_button(3, 0);
+    zassert_equal(RT_db_in()->button3, 0);
+    RT_db_let_swap();
+    zassert_equal(RT_db_in()->button3, 0);
+    zassert_equal(RT_db_in()->led3, 1);
+}
+
+static void rtdb_let_before(void *fixture) {
+    RT_db_init(&rtdb);
+}
+
+ZTEST_SUITE(rtdb_let, NULL, NULL, rtdb_let_before, NULL, NULL);
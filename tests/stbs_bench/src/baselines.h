@@ -0,0 +1,63 @@
+#ifndef BASELINES_H
+#define BASELINES_H
+
+#include <stdint.h>
+
+// Slack allowed over the build time baselines, in percent: the largest run-to-run spread of
+// the build time over its median, measured over 40 runs (32 %). The time is counted in steps of
+// a reference work timed with every configuration, so it follows the speed of the host, but it
+// is still noisier than the byte figures. It is only checked on qemu_x86 (BENCH_TIME_CHECKED).
+#define BENCH_TIME_TOLERANCE_PCT 35
+
+typedef struct {
+    int min_schedulable;        // schedulable sets out of BENCH_TRIALS
+    int max_table_bytes;        // biggest table built
+    int max_peak_heap;          // biggest heap usage of a build
+    uint32_t slot_csteps;       // build time per table slot, in hundredths of a step of the reference work
+} bench_baseline;
+
+// One row per configuration, in the order of the benchmark loops (size, utilization, periods).
+// Byte figures are for 32-bit targets (native_sim, qemu_x86, Cortex-M).
+// The time is the median of the BASELINE lines of several runs on qemu_x86; the other
+// platforms print the stored time back, so their lines only update the other figures.
+// The times below were taken on an x86 host build until they are recorded on qemu_x86.
+static const bench_baseline bench_baselines[] = {
+    {  8,    928,   1000,  1162 },   //  2 tasks, U 30%, harmonic
+    { 10,   2320,   2488,   983 },   //  2 tasks, U 30%, uniform
+    {  8,   1740,   1872,   853 },   //  2 tasks, U 30%, coprime
+    {  7,    464,   1000,  2014 },   //  2 tasks, U 60%, harmonic
+    {  2,    348,   3728,  1900 },   //  2 tasks, U 60%, uniform
+    {  4,    696,   1872,   977 },   //  2 tasks, U 60%, coprime
+    {  2,    464,   1000,  1475 },   //  2 tasks, U 90%, harmonic
+    {  2,    232,   1496,  2166 },   //  2 tasks, U 90%, uniform
+    {  0,      0,   1872,     0 },   //  2 tasks, U 90%, coprime
+    {  7,   1760,   1832,   888 },   //  4 tasks, U 30%, harmonic
+    {  9,  13200,  13688,   388 },   //  4 tasks, U 30%, uniform
+    { 10,   6600,   6848,   380 },   //  4 tasks, U 30%, coprime
+    {  5,   1760,   1832,   952 },   //  4 tasks, U 60%, harmonic
+    {  3,   6600,   6848,   481 },   //  4 tasks, U 60%, uniform
+    {  5,   6600,   6848,   490 },   //  4 tasks, U 60%, coprime
+    {  0,      0,   1832,     0 },   //  4 tasks, U 90%, harmonic
+    {  0,      0,   6848,     0 },   //  4 tasks, U 90%, uniform
+    {  1,   1320,   6848,   756 },   //  4 tasks, U 90%, coprime
+    { 10,   3424,   3496,   621 },   //  8 tasks, U 30%, harmonic
+    { 10,  25680,  26168,   284 },   //  8 tasks, U 30%, uniform
+    { 10,  12840,  13088,   319 },   //  8 tasks, U 30%, coprime
+    {  6,   3424,   3496,   648 },   //  8 tasks, U 60%, harmonic
+    {  8,  25680,  26168,   279 },   //  8 tasks, U 60%, uniform
+    { 10,  12840,  13088,   318 },   //  8 tasks, U 60%, coprime
+    {  2,   1712,   3496,   944 },   //  8 tasks, U 90%, harmonic
+    {  0,      0,  26168,     0 },   //  8 tasks, U 90%, uniform
+    {  0,      0,  13088,     0 },   //  8 tasks, U 90%, coprime
+    {  8,   5088,   5160,   624 },   // 12 tasks, U 30%, harmonic
+    { 10,  38160,  38648,   249 },   // 12 tasks, U 30%, uniform
+    { 10,  19080,  19328,   292 },   // 12 tasks, U 30%, coprime
+    {  6,   5088,   5160,   590 },   // 12 tasks, U 60%, harmonic
+    {  6,  38160,  38648,   257 },   // 12 tasks, U 60%, uniform
+    { 10,  19080,  19328,   288 },   // 12 tasks, U 60%, coprime
+    {  1,   5088,   5160,   604 },   // 12 tasks, U 90%, harmonic
+    {  0,      0,  38648,     0 },   // 12 tasks, U 90%, uniform
+    {  3,  19080,  19328,   330 },   // 12 tasks, U 90%, coprime
+};
+
+#endif // BASELINES_H
@@ -0,0 +1,375 @@
+/**
+ * @file
+ * @brief STBS table construction benchmark
+ *
+ * Builds the scheduler table for randomized task sets of several sizes, utilizations
+ * and period distributions, and records for each configuration the build time, the
+ * peak heap used by the build, the table size and the schedulability rate.
+ * The results are checked against the baselines in baselines.h, so a change that makes
+ * the tables bigger, the builder slower or rejects sets that used to be schedulable fails.
+ * The build time is counted in steps of a reference work timed with every configuration, and
+ * its baselines are checked on qemu_x86, where they are recorded; the other platforms print it.
+ * The same sets are then built with a window (streamed tables), which must accept exactly the
+ * same sets, release the same tasks with the same deferrals in every tick, with a table size
+ * that does not depend on the hyperperiod. Finally, a set that
+ * fits on the execution times alone must be rejected once the dispatcher overheads are counted.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+#include <zephyr/sys/sys_heap.h>
+
+#include "../../../include/stb_scheduler.h"
+#include "taskset.h"
+#include "baselines.h"
+
+#define BENCH_TICK_MS 20
+#define BENCH_MAX_TASKS 12
+#define BENCH_TRIALS 10
+#define BENCH_SEED 0x57B5
+#define BENCH_APP_HEAP 4096         // heap of the application (CONFIG_HEAP_MEM_POOL_SIZE)
+#define BENCH_WINDOW 8              // ticks of the streamed tables
+#define BENCH_BUILD_RUNS 3          // builds timed per set, the fastest is kept
+#define BENCH_CONFIG_RUNS 2         // runs of a configuration over its time baseline, the fastest is kept
+#define BENCH_REFERENCE_STEPS 10000 // steps of the reference work timed (see bench_reference_ns())
+#define BENCH_REFERENCE_RUNS 5      // the fastest run is kept
+// the build time baselines are recorded on qemu_x86 (see baselines.h)
+#define BENCH_TIME_CHECKED IS_ENABLED(CONFIG_BOARD_QEMU_X86)
+
+static const int bench_sizes[] = {2, 4, 8, 12};
+static const int bench_utilizations[] = {30, 60, 90};
+
+extern struct k_heap _system_heap;
+
+
+typedef struct {
+    int schedulable;            // number of trials that were schedulable
+    uint32_t max_build_us;      // slowest build
+    uint64_t build_ns;          // time of all the builds that succeeded
+    uint64_t slots;             // table slots (tick x task) they built
+    int max_macro_cycle;
+    int max_table_bytes;        // biggest table built
+    int max_peak_heap;          // biggest heap usage during a build (including failed ones)
+    int max_total_heap;         // biggest heap usage including the task table
+} bench_result;
+
+static size_t heap_allocated(void) {
+    struct sys_memory_stats stats;
+
+    sys_heap_runtime_stats_get(&_system_heap.heap, &stats);
+    return stats.allocated_bytes;
+}
+
+static size_t heap_max_allocated(void) {
+    struct sys_memory_stats stats;
+
+    sys_heap_runtime_stats_get(&_system_heap.heap, &stats);
+    return stats.max_allocated_bytes;
+}
+
+/**
+ * @brief Times the reference work the build times are counted in: placing a task in a slot of
+ * a table (copying its entry and reading it back), the step the builder repeats for every slot.
+ * @return Time of BENCH_REFERENCE_STEPS steps in ns, 0 if the cycle counter does not advance
+ * while code runs (native_sim).
+ */
+static uint64_t bench_reference_ns(void) {
+    static Task slots[BENCH_MAX_TASKS];
+    Task task = {.ticks = 1};
+    uint64_t best = UINT64_MAX;
+
+    for (int run = 0; run < BENCH_REFERENCE_RUNS; run++) {
+        uint32_t start = k_cycle_get_32();
+        for (int i = 0; i < BENCH_REFERENCE_STEPS; i++) {
+            Task *slot = &slots[i % BENCH_MAX_TASKS];
+            *slot = task;
+            compiler_barrier();     // every step is really done
+            task.exec_time += slot->ticks;
+        }
+        best = MIN(best, k_cyc_to_ns_floor64(k_cycle_get_32() - start));
+    }
+    return best;
+}
+
+/**
+ * @brief Builds the table of one task set and accumulates its metrics.
+ */
+static void bench_one(const gen_task *tasks, int n, bench_result *res) {
+    size_t base_heap = heap_allocated();
+
+    STBS_Init(BENCH_TICK_MS * USEC_PER_MSEC, BENCH_MAX_TASKS);
+    for (int i = 0; i < n; i++) {
+        // the table is only built, so the tasks never need a real thread;
+        // the sets are generated in ms, so they do not change with the scheduler time base
+        STBS_AddTask(tasks[i].ticks, (k_tid_t)(uintptr_t)(i + 1), tasks[i].priority,
+                     tasks[i].exec_time * USEC_PER_MSEC, "bench");
+    }
+
+    size_t before = heap_allocated();
+    sys_heap_runtime_stats_reset_max(&_system_heap.heap);
+
+    // the fastest of a few builds (each frees the previous table first), so a preemption
+    // of the board or of the qemu host is not counted as build time
+    uint32_t cycles = UINT32_MAX;
+    int ret = 0;
+    for (int run = 0; run < BENCH_BUILD_RUNS; run++) {
+        uint32_t start = k_cycle_get_32();
+        ret = STBS_BuildTable();
+        cycles = MIN(cycles, k_cycle_get_32() - start);
+    }
+
+    int peak_heap = heap_max_allocated() - before;
+    int total_heap = heap_max_allocated() - base_heap;
+    uint32_t build_us = k_cyc_to_us_floor32(cycles);
+
+    zassert_true(ret == 0 || ret == -ENOSPC, "unexpected build error %d", ret);
+    if (ret == 0) {
+        int slots = STBS_GetMacroCycle() * n;
+
+        res->schedulable++;
+        res->max_macro_cycle = MAX(res->max_macro_cycle, STBS_GetMacroCycle());
+        res->max_table_bytes = MAX(res->max_table_bytes, STBS_GetTableBytes());
+        res->build_ns += k_cyc_to_ns_floor64(cycles);
+        res->slots += slots;
+    }
+    res->max_build_us = MAX(res->max_build_us, build_us);
+    res->max_peak_heap = MAX(res->max_peak_heap, peak_heap);
+    res->max_total_heap = MAX(res->max_total_heap, total_heap);
+
+    STBS_destroy();
+    zassert_equal(heap_allocated(), base_heap, "scheduler leaked %d bytes",
+                  (int)(heap_allocated() - base_heap));
+}
+
+/**
+ * @brief Builds the task sets of one configuration and accumulates their metrics.
+ * @return Build time per table slot in hundredths of a step of the reference work, 0 if not measured.
+ */
+static uint32_t bench_config(int cfg, int n, int utilization, int periods, bench_result *res) {
+    gen_task tasks[BENCH_MAX_TASKS];
+    // timed again with every configuration, so that a slower host at any point of the run
+    // slows the reference as much as the builds
+    uint64_t reference = bench_reference_ns();
+
+    taskset_seed(BENCH_SEED + cfg);
+    for (int t = 0; t < BENCH_TRIALS; t++) {
+        taskset_generate(tasks, n, utilization, periods, BENCH_TICK_MS);
+        bench_one(tasks, n, res);
+    }
+    if (reference == 0 || res->slots == 0) {
+        return 0;
+    }
+    return res->build_ns * BENCH_REFERENCE_STEPS * 100 / reference / res->slots;
+}
+
+ZTEST(stbs_bench, test_table_build)
+{
+    int cfg = 0;
+    int regressions = 0;
+
+    zassert_equal(ARRAY_SIZE(bench_baselines),
+                  ARRAY_SIZE(bench_sizes) * ARRAY_SIZE(bench_utilizations) * PERIODS_NUM,
+                  "baselines.h does not match the benchmark configurations");
+
+    if (!BENCH_TIME_CHECKED) {
+        TC_PRINT("Build times not checked: the baselines are for qemu_x86\n");
+    }
+    TC_PRINT("| tasks | U %%  | periods  | sched | build us | ns/slot | steps/slot | ticks | table B | heap B | 4 KB |\n");
+    for (int s = 0; s < ARRAY_SIZE(bench_sizes); s++) {
+        for (int u = 0; u < ARRAY_SIZE(bench_utilizations); u++) {
+            for (int d = 0; d < PERIODS_NUM; d++, cfg++) {
+                const bench_baseline *base = &bench_baselines[cfg];
+                uint32_t limit = base->slot_csteps * (100 + BENCH_TIME_TOLERANCE_PCT) / 100;
+                bench_result res = {0};
+                int n = bench_sizes[s];
+                uint32_t slot_csteps = bench_config(cfg, n, bench_utilizations[u], d, &res);
+
+                // a configuration over its time is run again, so that a preemption of the qemu host
+                // during one run is not taken for a slower builder
+                for (int run = 1; run < BENCH_CONFIG_RUNS && BENCH_TIME_CHECKED && slot_csteps > limit; run++) {
+                    bench_result again = {0};
+                    slot_csteps = MIN(slot_csteps, bench_config(cfg, n, bench_utilizations[u], d, &again));
+                }
+                TC_PRINT("| %5d | %4d | %-8s | %2d/%2d | %8u | %7u | %7u.%02u | %5d | %7d | %6d | %-4s |\n",
+                         n, bench_utilizations[u], taskset_dist_name(d),
+                         res.schedulable, BENCH_TRIALS, res.max_build_us,
+                         res.slots > 0 ? (uint32_t)(res.build_ns / res.slots) : 0, slot_csteps / 100, slot_csteps % 100,
+                         res.max_macro_cycle, res.max_table_bytes, res.max_peak_heap,
+                         res.max_total_heap <= BENCH_APP_HEAP ? "yes" : "no");
+                // line to paste in baselines.h when a change is accepted (the stored time when it was not measured)
+                TC_PRINT("BASELINE { %d, %d, %d, %u },\n",
+                         res.schedulable, res.max_table_bytes, res.max_peak_heap,
+                         BENCH_TIME_CHECKED ? slot_csteps : base->slot_csteps);
+
+                int slower = BENCH_TIME_CHECKED && base->slot_csteps > 0 && slot_csteps > limit;
+                if (res.schedulable < base->min_schedulable ||
+                    res.max_table_bytes > base->max_table_bytes ||
+                    res.max_peak_heap > base->max_peak_heap || slower) {
+                    TC_PRINT("REGRESSION in configuration %d (baseline { %d, %d, %d, %u })\n", cfg,
+                             base->min_schedulable, base->max_table_bytes, base->max_peak_heap,
+                             base->slot_csteps);
+                    regressions++;
+                }
+            }
+        }
+    }
+    zassert_equal(regressions, 0, "%d configurations regressed", regressions);
+}
+
+#define BENCH_COMPARE_TICKS 64      // longest macro-cycle whose ticks are compared (the generated sets have at most 60)
+
+// A task released in a tick of the whole table, and the ticks it was deferred
+typedef struct {
+    k_tid_t id;
+    int delay_count;
+} bench_release;
+
+static bench_release full_releases[BENCH_COMPARE_TICKS][STBS_MAX_CPUS][BENCH_MAX_TASKS];
+static int full_num_releases[BENCH_COMPARE_TICKS][STBS_MAX_CPUS];
+
+/**
+ * @brief Records the releases of a tick of the whole table, or checks that the window releases
+ * the same tasks, in the same order and with the same deferrals.
+ * @param seq Tick counted from the first release.
+ * @param cpu CPU of the table.
+ * @param macro_cycle Ticks of the table.
+ * @param windowed 0 to record the whole table, 1 to check the window against it.
+ */
+static void check_tick(uint32_t seq, int cpu, int macro_cycle, int windowed) {
+    Task released[BENCH_MAX_TASKS];
+    int tick = seq % macro_cycle;
+    int n = STBS_GetTickTasks(0, cpu, seq, released, BENCH_MAX_TASKS);
+
+    zassert_true(n >= 0 && n <= BENCH_MAX_TASKS, "tick %u: error %d", seq, n);
+    if (!windowed) {
+        full_num_releases[tick][cpu] = n;
+        for (int k = 0; k < n; k++) {
+            full_releases[tick][cpu][k] = (bench_release){released[k].id, released[k].delay_count};
+        }
+        return;
+    }
+    zassert_equal(n, full_num_releases[tick][cpu], "tick %u: %d tasks released, %d in the whole table",
+                  seq, n, full_num_releases[tick][cpu]);
+    for (int k = 0; k < n; k++) {
+        zassert_equal(released[k].id, full_releases[tick][cpu][k].id, "tick %u: task %d differs", seq, k);
+        zassert_equal(released[k].delay_count, full_releases[tick][cpu][k].delay_count,
+                      "tick %u: task %d deferred %d ticks, %d in the whole table",
+                      seq, k, released[k].delay_count, full_releases[tick][cpu][k].delay_count);
+    }
+}
+
+// Builds a task set with the whole table and with a window, and returns both results;
+// when both are built, the window must release every tick as the whole table does
+static void build_both(const gen_task *tasks, int n, int *full, int *windowed) {
+    for (int w = 0; w < 2; w++) {
+        STBS_Init(BENCH_TICK_MS * USEC_PER_MSEC, BENCH_MAX_TASKS);
+        for (int i = 0; i < n; i++) {
+            STBS_AddTask(tasks[i].ticks, (k_tid_t)(uintptr_t)(i + 1), tasks[i].priority,
+                         tasks[i].exec_time * USEC_PER_MSEC, "bench");
+        }
+        zassert_ok(STBS_SetWindow(w ? BENCH_WINDOW : 0));
+        *(w ? windowed : full) = STBS_BuildTable();
+        if (w && *windowed == 0) {
+            int max_bytes = BENCH_WINDOW * (STBS_GetNumCpus() * sizeof(scheduler_table_entry) + n * sizeof(Task) + sizeof(uint32_t));
+            zassert_true(STBS_GetTableBytes() <= max_bytes, "window of %d bytes", STBS_GetTableBytes());
+        }
+        int macro_cycle = STBS_GetMacroCycle();
+        if (*full == 0 && (!w || *windowed == 0) && macro_cycle <= BENCH_COMPARE_TICKS) {
+            // two macro-cycles of the window: its release state restarts as the whole table does
+            for (uint32_t seq = 0; seq < (w ? 2 : 1) * macro_cycle; seq++) {
+                for (int cpu = 0; cpu < STBS_GetNumCpus(); cpu++) {
+                    check_tick(seq, cpu, macro_cycle, w);
+                }
+            }
+        }
+        STBS_destroy();
+    }
+}
+
+ZTEST(stbs_bench, test_window_build)
+{
+    gen_task tasks[BENCH_MAX_TASKS];
+    int full, windowed;
+
+    // the window places the same jobs as the whole table, so it accepts the same sets and releases the same ticks
+    for (int cfg = 0; cfg < ARRAY_SIZE(bench_baselines); cfg++) {
+        int n = bench_sizes[cfg / (ARRAY_SIZE(bench_utilizations) * PERIODS_NUM)];
+        int u = bench_utilizations[(cfg / PERIODS_NUM) % ARRAY_SIZE(bench_utilizations)];
+
+        taskset_seed(BENCH_SEED + cfg);
+        for (int t = 0; t < BENCH_TRIALS; t++) {
+            taskset_generate(tasks, n, u, cfg % PERIODS_NUM, BENCH_TICK_MS);
+            build_both(tasks, n, &full, &windowed);
+            if (full != -E2BIG) {
+                zassert_equal(windowed, full, "configuration %d: window %d, whole table %d", cfg, windowed, full);
+            }
+        }
+    }
+
+    // coprime periods: a macro-cycle of 17017 ticks that only fits as a window
+    const gen_task coprime[] = {{7, 1, 1}, {11, 1, 1}, {13, 1, 1}, {17, 1, 1}};
+    build_both(coprime, ARRAY_SIZE(coprime), &full, &windowed);
+    zassert_equal(full, -E2BIG);
+    zassert_ok(windowed);
+}
+
+ZTEST(stbs_bench, test_overhead)
+{
+    static const STBS_overhead no_overhead = {0};
+    static const STBS_overhead board_overhead = {.tick_us = 200, .release_us = 100};
+    STBS_overhead current;
+
+    // the test thread is cooperative, so a calibration would never switch to its thread
+    if (!k_is_preempt_thread()) {
+        zassert_equal(STBS_Calibrate(), -EPERM);
+        STBS_GetOverhead(&current);
+        zassert_equal(current.tick_us, 0, "the overheads were changed by a failed calibration");
+    }
+    zassert_equal(STBS_SetOverhead(&(STBS_overhead){.tick_us = -1}), -EINVAL);
+
+    // two tasks that fill every tick exactly: schedulable on the execution times alone
+    for (int o = 0; o < 2; o++) {
+        zassert_ok(STBS_SetOverhead(o ? &board_overhead : &no_overhead));
+        STBS_Init(BENCH_TICK_MS * USEC_PER_MSEC, BENCH_MAX_TASKS);
+        for (int i = 0; i < 2; i++) {
+            STBS_AddTask(1, (k_tid_t)(uintptr_t)(i + 1), 1, BENCH_TICK_MS * USEC_PER_MSEC / 2, "bench");
+        }
+        int ret = STBS_BuildTable();
+        STBS_destroy();
+        if (o) {
+            zassert_equal(ret, -ENOSPC, "the overheads of the dispatcher were not counted (%d)", ret);
+        } else {
+            zassert_ok(ret);
+        }
+    }
+    zassert_ok(STBS_SetOverhead(&no_overhead));
+}
+
+ZTEST(stbs_bench, test_init_no_memory)
+{
+    size_t base_heap = heap_allocated();
+
+    // a task table bigger than the heap: the tasks are refused instead of written through NULL
+    STBS_Init(BENCH_TICK_MS * USEC_PER_MSEC, CONFIG_HEAP_MEM_POOL_SIZE / sizeof(Task) + 1);
+    STBS_AddTask(1, (k_tid_t)(uintptr_t)1, 1, USEC_PER_MSEC, "bench");
+    zassert_equal(STBS_GetNumTasks(), 0);
+    zassert_equal(STBS_BuildTable(), -ENOMEM);
+    STBS_destroy();
+    zassert_equal(heap_allocated(), base_heap, "scheduler leaked %d bytes", (int)(heap_allocated() - base_heap));
+
+    // a new initialization recovers
+    STBS_Init(BENCH_TICK_MS * USEC_PER_MSEC, BENCH_MAX_TASKS);
+    STBS_AddTask(1, (k_tid_t)(uintptr_t)1, 1, USEC_PER_MSEC, "bench");
+    zassert_ok(STBS_BuildTable());
+    STBS_destroy();
+}
+
+static void *stbs_bench_setup(void) {
+    // the baselines are for the execution times alone, not for the overheads of the board
+    static const STBS_overhead no_overhead = {0};
+
+    zassert_ok(STBS_SetOverhead(&no_overhead));
+    return NULL;
+}
+
+ZTEST_SUITE(stbs_bench, NULL, stbs_bench_setup, NULL, NULL, NULL);
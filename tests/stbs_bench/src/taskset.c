@@ -0,0 +1,65 @@
+#include "taskset.h"
+
+static const int harmonic_periods[] = {1, 2, 4, 8};
+static const int coprime_periods[] = {2, 3, 5};
+
+static uint32_t rand_state = 1;
+
+// xorshift32: same sequence on every platform, so the generated sets are reproducible
+static uint32_t taskset_rand(void) {
+    rand_state ^= rand_state << 13;
+    rand_state ^= rand_state >> 17;
+    rand_state ^= rand_state << 5;
+    return rand_state;
+}
+
+void taskset_seed(uint32_t seed) {
+    rand_state = seed ? seed : 1;
+}
+
+/**
+ * @brief Generates a random task set with a given total utilization.
+ * The utilization is split among the tasks with random weights, and every task gets
+ * at least 1 ms of execution time.
+ * @param tasks Where to store the tasks.
+ * @param n Number of tasks.
+ * @param utilization_pct Total utilization of the set, in percent of the tick.
+ * @param dist Distribution of the periods.
+ * @param tick_ms Tick duration in milliseconds.
+ */
+void taskset_generate(gen_task *tasks, int n, int utilization_pct, period_dist dist, int tick_ms) {
+    int weights[n];
+    int total_weight = 0;
+
+    for (int i = 0; i < n; i++) {
+        weights[i] = 1 + taskset_rand() % 100;
+        total_weight += weights[i];
+    }
+
+    for (int i = 0; i < n; i++) {
+        switch (dist) {
+        case PERIODS_HARMONIC:
+            tasks[i].ticks = harmonic_periods[taskset_rand() % 4];
+            break;
+        case PERIODS_UNIFORM:
+            tasks[i].ticks = 1 + taskset_rand() % 6;
+            break;
+        default:
+            tasks[i].ticks = coprime_periods[taskset_rand() % 3];
+            break;
+        }
+        tasks[i].priority = 1 + taskset_rand() % 5;
+
+        // C_i = U_i * T_i, with U_i the share of the total utilization of this task
+        int exec_time = (utilization_pct * weights[i] * tasks[i].ticks * tick_ms) / (100 * total_weight);
+        tasks[i].exec_time = exec_time > 0 ? exec_time : 1;
+    }
+}
+
+const char *taskset_dist_name(period_dist dist) {
+    switch (dist) {
+    case PERIODS_HARMONIC: return "harmonic";
+    case PERIODS_UNIFORM: return "uniform";
+    default: return "coprime";
+    }
+}
@@ -0,0 +1,24 @@
+#include <stdint.h>
+
+#ifndef TASKSET_H
+#define TASKSET_H
+
+// Distribution of the task periods (in ticks)
+typedef enum {
+    PERIODS_HARMONIC,       // 1, 2, 4, 8
+    PERIODS_UNIFORM,        // 1..6
+    PERIODS_COPRIME,        // 2, 3, 5
+    PERIODS_NUM
+} period_dist;
+
+typedef struct {
+    int ticks;              // period in ticks
+    int priority;
+    int exec_time;          // execution time in ms
+} gen_task;
+
+void taskset_seed(uint32_t seed);
+void taskset_generate(gen_task *tasks, int n, int utilization_pct, period_dist dist, int tick_ms);
+const char *taskset_dist_name(period_dist dist);
+
+#endif // TASKSET_H
@@ -0,0 +1,274 @@
+/**
+ * @file
+ * @brief STBS partitioned multi-core tests
+ *
+ * Checks that a task set that does not fit one core is partitioned among the CPUs,
+ * and that every task, thread or job, is then released on the CPU it was assigned to,
+ * also when the tasks are split in rate groups or the tables are streamed in a window,
+ * and when a background task takes all the time the tables leave idle.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+
+#include "../../../include/stb_scheduler.h"
+
+#define TEST_TICK_MS 10
+#define TEST_NUM_TASKS 4
+#define TEST_RUN_TICKS 20
+#define TEST_STACK_SIZE 1024
+
+static struct k_thread task_thread[TEST_NUM_TASKS];
+static K_THREAD_STACK_ARRAY_DEFINE(task_stack, TEST_NUM_TASKS, TEST_STACK_SIZE);
+static atomic_t activations[TEST_NUM_TASKS];
+static atomic_t cpus_seen[TEST_NUM_TASKS];      // bit c set if the task ran on CPU c
+
+// period (ticks), priority and execution time (us): 150 % of one core, leaving room for the dispatcher overhead
+static const int task_params[TEST_NUM_TASKS][3] = {
+    {1, 1, 6000},
+    {1, 1, 6000},
+    {2, 2, 3000},
+    {2, 2, 3000},
+};
+static char *task_names[TEST_NUM_TASKS] = {"a", "b", "c", "d"};
+static k_tid_t thread_ids[TEST_NUM_TASKS] = {&task_thread[0], &task_thread[1], &task_thread[2], &task_thread[3]};
+
+static struct k_thread background_thread;
+static K_THREAD_STACK_DEFINE(background_stack, TEST_STACK_SIZE);
+static volatile uint32_t background_loops;
+
+static void record_release(int idx) {
+    atomic_inc(&activations[idx]);
+    atomic_or(&cpus_seen[idx], BIT(arch_curr_cpu()->id));
+}
+
+static void test_task(void *argA, void *argB, void *argC) {
+    while (1) {
+        STBS_WaitRelease();
+        record_release((int)(intptr_t)argA);
+    }
+}
+
+// a job function can be added only once, so each job has its own
+static void test_job_a(void *arg) {
+    record_release((int)(intptr_t)arg);
+}
+
+static void test_job_b(void *arg) {
+    record_release((int)(intptr_t)arg);
+}
+
+static void add_tasks(void) {
+    STBS_Init(TEST_TICK_MS * USEC_PER_MSEC, TEST_NUM_TASKS);
+    for (int i = 0; i < TEST_NUM_TASKS; i++) {
+        STBS_AddTask(task_params[i][0], &task_thread[i], task_params[i][1], task_params[i][2], task_names[i]);
+    }
+}
+
+static int task_cpu(k_tid_t id) {
+    const Task *tasks = STBS_GetTaskTable();
+
+    for (int i = 0; i < STBS_GetNumTasks(); i++) {
+        if (tasks[i].id == id) {
+            return tasks[i].cpu;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Checks that every task was released the expected number of times, only on its CPU.
+ * @param ids Identifiers of the tasks, in the order of task_params.
+ */
+static void check_releases(const k_tid_t *ids) {
+    for (int i = 0; i < TEST_NUM_TASKS; i++) {
+        int cpu = task_cpu(ids[i]);
+        int expected = TEST_RUN_TICKS / task_params[i][0];
+
+        zassert_true(cpu >= 0);
+        zassert_within(atomic_get(&activations[i]), expected, 2,
+                       "task %s released %d times, expected %d", task_names[i],
+                       (int)atomic_get(&activations[i]), expected);
+        zassert_equal(atomic_get(&cpus_seen[i]), BIT(cpu),
+                      "task %s ran outside CPU %d", task_names[i], cpu);
+
+        STBS_task_stats stats;
+        zassert_ok(STBS_GetTaskStats(i, &stats));
+        zassert_within(stats.activations, atomic_get(&activations[i]), 1);
+        zassert_equal(stats.overruns, 0, "task %s overran", task_names[i]);
+    }
+}
+
+// never blocks: it only leaves the CPU when it is preempted
+static void background_task(void *argA, void *argB, void *argC) {
+    while (1) {
+        background_loops++;
+    }
+}
+
+static void *stbs_smp_setup(void) {
+    for (int i = 0; i < TEST_NUM_TASKS; i++) {
+        k_thread_create(&task_thread[i], task_stack[i], K_THREAD_STACK_SIZEOF(task_stack[i]),
+                        test_task, (void *)(intptr_t)i, NULL, NULL, K_PRIO_PREEMPT(5), 0, K_NO_WAIT);
+    }
+    return NULL;
+}
+
+ZTEST(stbs_smp, test_partition)
+{
+    zassert_true(arch_num_cpus() >= 2, "test needs 2 CPUs");
+
+    add_tasks();
+    zassert_ok(STBS_SetNumCpus(1));
+    zassert_equal(STBS_BuildTable(), -ENOSPC, "set should not fit one core");
+
+    zassert_ok(STBS_SetNumCpus(2));
+    zassert_ok(STBS_BuildTable(), "set should fit two cores");
+    zassert_not_equal(task_cpu(&task_thread[0]), task_cpu(&task_thread[1]),
+                      "the two 60 %% tasks must be on different CPUs");
+    for (int cpu = 0; cpu < 2; cpu++) {
+        for (int tick = 0; tick < STBS_GetMacroCycle(); tick++) {
+            zassert_true(STBS_GetTickSlack(cpu, tick) >= 0);
+        }
+    }
+    STBS_destroy();
+}
+
+ZTEST(stbs_smp, test_pinned_release)
+{
+    add_tasks();
+    zassert_ok(STBS_SetNumCpus(2));
+    for (int i = 0; i < TEST_NUM_TASKS; i++) {
+        atomic_clear(&activations[i]);
+        atomic_clear(&cpus_seen[i]);
+    }
+
+    zassert_ok(STBS_Start());
+    k_msleep(STBS_START_DELAY_MS + TEST_RUN_TICKS * TEST_TICK_MS);
+    zassert_ok(STBS_Stop());
+
+    check_releases(thread_ids);
+
+    // the scheduler can be restarted after a stop
+    zassert_ok(STBS_Start());
+    k_msleep(STBS_START_DELAY_MS + TEST_TICK_MS);
+    STBS_destroy();
+}
+
+ZTEST(stbs_smp, test_jobs)
+{
+    // a and b run as jobs on the dispatchers, c and d as threads
+    k_tid_t ids[TEST_NUM_TASKS] = {STBS_JOB_ID(test_job_a), STBS_JOB_ID(test_job_b), &task_thread[2], &task_thread[3]};
+
+    STBS_Init(TEST_TICK_MS * USEC_PER_MSEC, TEST_NUM_TASKS);
+    STBS_AddJob(task_params[0][0], test_job_a, (void *)0, task_params[0][1], task_params[0][2], task_names[0]);
+    STBS_AddJob(task_params[1][0], test_job_b, (void *)1, task_params[1][1], task_params[1][2], task_names[1]);
+    for (int i = 2; i < TEST_NUM_TASKS; i++) {
+        STBS_AddTask(task_params[i][0], ids[i], task_params[i][1], task_params[i][2], task_names[i]);
+    }
+    zassert_ok(STBS_SetNumCpus(2));
+    for (int i = 0; i < TEST_NUM_TASKS; i++) {
+        atomic_clear(&activations[i]);
+        atomic_clear(&cpus_seen[i]);
+    }
+
+    zassert_ok(STBS_Start());
+    k_msleep(STBS_START_DELAY_MS + TEST_RUN_TICKS * TEST_TICK_MS);
+    zassert_ok(STBS_Stop());
+    check_releases(ids);
+    STBS_destroy();
+}
+
+ZTEST(stbs_smp, test_rate_groups)
+{
+    // c and d run in a group with a tick as long as their period, in the time a and b leave
+    STBS_Init(TEST_TICK_MS * USEC_PER_MSEC, TEST_NUM_TASKS);
+    zassert_equal(STBS_AddGroup(TEST_TICK_MS * USEC_PER_MSEC / 2), -EINVAL, "groups must get slower");
+    zassert_equal(STBS_AddGroup(2 * TEST_TICK_MS * USEC_PER_MSEC), 1);
+    for (int i = 0; i < TEST_NUM_TASKS; i++) {
+        int group = task_params[i][0] == 2;
+
+        STBS_AddTask(group ? 1 : task_params[i][0], thread_ids[i], task_params[i][1], task_params[i][2], task_names[i]);
+        zassert_ok(STBS_SetGroup(thread_ids[i], group));
+    }
+    zassert_equal(STBS_SetGroup(thread_ids[0], 2), -EINVAL);
+    zassert_equal(STBS_AddPrecedence(thread_ids[0], thread_ids[2], 0), 0);
+    zassert_equal(STBS_BuildTable(), -EINVAL, "precedences cannot join two groups");
+
+    STBS_Init(TEST_TICK_MS * USEC_PER_MSEC, TEST_NUM_TASKS);
+    STBS_AddGroup(2 * TEST_TICK_MS * USEC_PER_MSEC);
+    for (int i = 0; i < TEST_NUM_TASKS; i++) {
+        int group = task_params[i][0] == 2;
+
+        STBS_AddTask(group ? 1 : task_params[i][0], thread_ids[i], task_params[i][1], task_params[i][2], task_names[i]);
+        STBS_SetGroup(thread_ids[i], group);
+    }
+    zassert_ok(STBS_SetNumCpus(2));
+    zassert_ok(STBS_BuildTable());
+    zassert_equal(STBS_GetGroupMacroCycle(0), 1);
+    zassert_equal(STBS_GetGroupMacroCycle(1), 1);
+    for (int cpu = 0; cpu < 2; cpu++) {
+        zassert_true(STBS_GetGroupTickSlack(1, cpu, 0) >= 0);
+    }
+
+    for (int i = 0; i < TEST_NUM_TASKS; i++) {
+        atomic_clear(&activations[i]);
+        atomic_clear(&cpus_seen[i]);
+    }
+    zassert_ok(STBS_Start());
+    k_msleep(STBS_START_DELAY_MS + TEST_RUN_TICKS * TEST_TICK_MS);
+    zassert_ok(STBS_Stop());
+    check_releases(thread_ids);
+    STBS_destroy();
+}
+
+ZTEST(stbs_smp, test_window)
+{
+    // the smallest window: the filler keeps one tick ahead of the dispatchers
+    add_tasks();
+    zassert_ok(STBS_SetNumCpus(2));
+    zassert_equal(STBS_SetWindow(3), -EINVAL);
+    zassert_ok(STBS_SetWindow(2));
+    for (int i = 0; i < TEST_NUM_TASKS; i++) {
+        atomic_clear(&activations[i]);
+        atomic_clear(&cpus_seen[i]);
+    }
+
+    zassert_ok(STBS_Start());
+    k_msleep(STBS_START_DELAY_MS + TEST_RUN_TICKS * TEST_TICK_MS);
+    zassert_ok(STBS_Stop());
+    check_releases(thread_ids);
+    STBS_destroy();
+}
+
+ZTEST(stbs_smp, test_background)
+{
+    add_tasks();
+    zassert_ok(STBS_SetNumCpus(2));
+    k_thread_create(&background_thread, background_stack, K_THREAD_STACK_SIZEOF(background_stack),
+                    background_task, NULL, NULL, NULL, K_PRIO_PREEMPT(5), 0, K_FOREVER);
+    zassert_equal(STBS_AddBackground(&task_thread[0], 0, "a"), -EINVAL, "table tasks cannot be in the lane");
+    zassert_equal(STBS_AddBackground(&background_thread, STBS_BACKGROUND_LEVELS, "bg"), -EINVAL);
+    zassert_ok(STBS_AddBackground(&background_thread, 0, "bg"));
+    zassert_equal(STBS_AddBackground(&background_thread, 1, "bg"), -EINVAL);
+    zassert_equal(k_thread_priority_get(&background_thread), STBS_BACKGROUND_PRIORITY(0));
+    for (int i = 0; i < TEST_NUM_TASKS; i++) {
+        atomic_clear(&activations[i]);
+        atomic_clear(&cpus_seen[i]);
+    }
+    background_loops = 0;
+
+    zassert_ok(STBS_Start());
+    k_thread_start(&background_thread);
+    k_msleep(STBS_START_DELAY_MS + TEST_RUN_TICKS * TEST_TICK_MS);
+    zassert_ok(STBS_Stop());
+    k_thread_abort(&background_thread);
+
+    // the table keeps its releases, and the background task gets the time left
+    check_releases(thread_ids);
+    zassert_true(background_loops > 0, "the background task got no idle time");
+    zassert_true(STBS_GetBackgroundBudget() > 0);
+    STBS_destroy();
+}
+
+ZTEST_SUITE(stbs_smp, NULL, stbs_smp_setup, NULL, NULL, NULL);
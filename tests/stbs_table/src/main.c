@@ -0,0 +1,372 @@
+/**
+ * @file
+ * @brief STBS table check and construction tests
+ *
+ * Checks the analytical schedulability check on small task sets with known figures:
+ * its error paths (invalid parameters and precedences, sets that cannot be scheduled,
+ * tables that do not fit in memory), the report it fills and the task it names, and that
+ * it leaves the task table as it was and allocates nothing. Then checks the slack of the
+ * built table and the errors of its getters before there is a table to read, and the
+ * precedences: producers placed before their consumers in every tick, the lag bound, cycles,
+ * and the latency of a chain whose tasks run back to back. Finally checks the jitter bounds:
+ * a bounded task is placed first in every tick, and a bound no order can meet fails the build.
+ * The tables are only built, never run, so the tasks need no real threads.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+#include <zephyr/sys/sys_heap.h>
+
+#include "../../../include/stb_scheduler.h"
+
+#define TEST_TICK_MS 10
+#define TEST_TICK_US (TEST_TICK_MS * USEC_PER_MSEC)
+#define TEST_MAX_TASKS 4
+
+extern struct k_heap _system_heap;
+
+// identifier of the i-th task added (the tables are never run)
+#define TASK_ID(i) ((k_tid_t)(uintptr_t)((i) + 1))
+
+/**
+ * @brief Adds a task with the next identifier, at the index of the task table it was added in.
+ * @return Index of the task.
+ */
+static int add_task(int ticks, int priority, int exec_time, char *name) {
+    int index = STBS_GetNumTasks();
+
+    STBS_AddTask(ticks, TASK_ID(index), priority, exec_time, name);
+    zassert_equal(STBS_GetNumTasks(), index + 1, "task %s not added", name);
+    return index;
+}
+
+ZTEST(stbs_table, test_check_invalid)
+{
+    STBS_check_report report;
+
+    // a task with no period
+    STBS_Init(TEST_TICK_US, TEST_MAX_TASKS);
+    add_task(1, 1, 1000, "a");
+    int bad = add_task(0, 1, 1000, "b");
+    zassert_equal(STBS_Check(&report), -EINVAL);
+    zassert_equal(report.failed_task, bad);
+    zassert_equal(report.failed_cpu, -1);
+    zassert_equal(STBS_BuildTable(), -EINVAL);
+
+    // precedences in a cycle
+    STBS_Init(TEST_TICK_US, TEST_MAX_TASKS);
+    int a = add_task(1, 1, 1000, "a");
+    int b = add_task(1, 1, 1000, "b");
+    zassert_ok(STBS_AddPrecedence(TASK_ID(a), TASK_ID(b), 0));
+    zassert_ok(STBS_AddPrecedence(TASK_ID(b), TASK_ID(a), 0));
+    zassert_equal(STBS_Check(&report), -EINVAL);
+    zassert_true(report.failed_task == a || report.failed_task == b);
+
+    // a precedence with a task that is not registered
+    STBS_Init(TEST_TICK_US, TEST_MAX_TASKS);
+    a = add_task(1, 1, 1000, "a");
+    zassert_ok(STBS_AddPrecedence(TASK_ID(a), TASK_ID(TEST_MAX_TASKS), 0));
+    zassert_equal(STBS_Check(NULL), -EINVAL);
+    STBS_destroy();
+}
+
+ZTEST(stbs_table, test_check_not_schedulable)
+{
+    STBS_check_report report;
+
+    // a task longer than the tick
+    STBS_Init(TEST_TICK_US, TEST_MAX_TASKS);
+    add_task(1, 1, 1000, "a");
+    int b = add_task(2, 1, TEST_TICK_US + 1, "b");
+    zassert_equal(STBS_Check(&report), -ENOSPC);
+    zassert_equal(report.failed_task, b);
+    zassert_equal(report.failed_cpu, 0);
+    zassert_equal(STBS_BuildTable(), -ENOSPC);
+
+    // 60 % + 45 %: the task that takes the most of the CPU is named
+    STBS_Init(TEST_TICK_US, TEST_MAX_TASKS);
+    add_task(2, 1, 9000, "a");
+    b = add_task(1, 1, 6000, "b");
+    zassert_equal(STBS_Check(&report), -ENOSPC);
+    zassert_equal(report.utilization, 1050);
+    zassert_equal(report.failed_task, b);
+    zassert_equal(report.failed_cpu, 0);
+    zassert_equal(STBS_BuildTable(), -ENOSPC);
+    STBS_destroy();
+}
+
+ZTEST(stbs_table, test_check_too_big)
+{
+    STBS_check_report report;
+
+    // coprime periods: a macro-cycle of 97 * 89 * 83 ticks
+    STBS_Init(TEST_TICK_US, TEST_MAX_TASKS);
+    add_task(97, 1, 100, "a");
+    add_task(89, 1, 100, "b");
+    add_task(83, 1, 100, "c");
+    zassert_equal(STBS_Check(&report), -E2BIG);
+    zassert_equal(report.hyperperiod, 97 * 89 * 83);
+    zassert_true(report.table_bytes > STBS_MAX_TABLE_BYTES);
+    zassert_equal(report.failed_task, -1, "no task fails a condition");
+    zassert_equal(STBS_BuildTable(), -E2BIG);
+    STBS_destroy();
+}
+
+ZTEST(stbs_table, test_check_report)
+{
+    STBS_check_report report;
+
+    // 20 % + 20 % + 5 %, 8 ms when all are released together
+    STBS_Init(TEST_TICK_US, TEST_MAX_TASKS);
+    add_task(1, 1, 2000, "a");
+    add_task(2, 1, 4000, "b");
+    add_task(4, 1, 2000, "c");
+    zassert_ok(STBS_Check(&report));
+    zassert_equal(report.utilization, 450);
+    zassert_equal(report.max_tick_demand, 8000);
+    zassert_equal(report.hyperperiod, 4);
+    zassert_equal(report.table_bytes, 4 * (sizeof(scheduler_table_entry) + 3 * sizeof(Task)));
+    zassert_true(report.sufficient, "every tick fits all the tasks");
+    zassert_equal(report.failed_task, -1);
+    zassert_equal(report.failed_cpu, -1);
+
+    // 11 ms when released together: schedulable only by deferring a task to tick 1
+    STBS_Init(TEST_TICK_US, TEST_MAX_TASKS);
+    add_task(2, 1, 5000, "a");
+    add_task(2, 1, 6000, "b");
+    zassert_ok(STBS_Check(&report));
+    zassert_equal(report.max_tick_demand, 11000);
+    zassert_false(report.sufficient, "tick 0 does not fit all the tasks");
+    zassert_ok(STBS_BuildTable());
+    STBS_destroy();
+}
+
+ZTEST(stbs_table, test_check_no_side_effects)
+{
+    Task before[TEST_MAX_TASKS];
+    struct sys_memory_stats heap;
+
+    // added in the reverse of the order the builder places them, the consumer before its producer
+    STBS_Init(TEST_TICK_US, TEST_MAX_TASKS);
+    int consumer = add_task(1, 1, 1000, "consumer");
+    add_task(2, 2, 1000, "b");
+    int producer = add_task(1, 3, 1000, "producer");
+    zassert_ok(STBS_AddPrecedence(TASK_ID(producer), TASK_ID(consumer), 0));
+    memcpy(before, STBS_GetTaskTable(), STBS_GetNumTasks() * sizeof(Task));
+
+    sys_heap_runtime_stats_reset_max(&_system_heap.heap);
+    zassert_ok(STBS_Check(NULL));
+    sys_heap_runtime_stats_get(&_system_heap.heap, &heap);
+    zassert_equal(heap.max_allocated_bytes, heap.allocated_bytes, "the check allocated memory");
+    zassert_mem_equal(STBS_GetTaskTable(), before, STBS_GetNumTasks() * sizeof(Task),
+                      "the check changed the task table");
+
+    // the builder orders them
+    zassert_ok(STBS_BuildTable());
+    const Task *tasks = STBS_GetTaskTable();
+    int producer_index = -1, consumer_index = -1;
+    for (int i = 0; i < STBS_GetNumTasks(); i++) {
+        producer_index = tasks[i].id == TASK_ID(producer) ? i : producer_index;
+        consumer_index = tasks[i].id == TASK_ID(consumer) ? i : consumer_index;
+    }
+    zassert_true(producer_index >= 0 && producer_index < consumer_index, "producer not placed first");
+    STBS_destroy();
+}
+
+ZTEST(stbs_table, test_tick_slack)
+{
+    // no table yet
+    STBS_Init(TEST_TICK_US, TEST_MAX_TASKS);
+    add_task(1, 1, 2000, "a");
+    add_task(2, 1, 4000, "b");
+    zassert_equal(STBS_GetTickSlack(0, 0), -ENODATA);
+    zassert_equal(STBS_GetGroupTickSlack(0, 0, 0), -ENODATA);
+
+    zassert_ok(STBS_BuildTable());
+    zassert_equal(STBS_GetMacroCycle(), 2);
+    zassert_equal(STBS_GetTickSlack(0, 0), TEST_TICK_US - 6000);
+    zassert_equal(STBS_GetTickSlack(0, 1), TEST_TICK_US - 2000);
+    zassert_equal(STBS_GetGroupTickSlack(0, 0, 1), TEST_TICK_US - 2000);
+
+    // out of range
+    zassert_equal(STBS_GetTickSlack(0, -1), -EINVAL);
+    zassert_equal(STBS_GetTickSlack(0, 2), -EINVAL);
+    zassert_equal(STBS_GetTickSlack(-1, 0), -EINVAL);
+    zassert_equal(STBS_GetTickSlack(STBS_GetNumCpus(), 0), -EINVAL);
+    zassert_equal(STBS_GetGroupTickSlack(-1, 0, 0), -EINVAL);
+    zassert_equal(STBS_GetGroupTickSlack(STBS_GetNumGroups(), 0, 0), -EINVAL);
+
+    // the table is freed with the tasks
+    STBS_destroy();
+    zassert_equal(STBS_GetTickSlack(0, 0), -ENODATA);
+}
+
+// Position of a task among the ones released in a tick of group 0 and CPU 0, or -1
+static int tick_position(int tick, k_tid_t id) {
+    Task released[TEST_MAX_TASKS];
+    int n = STBS_GetTickTasks(0, 0, tick, released, TEST_MAX_TASKS);
+
+    zassert_true(n >= 0, "tick %d: error %d", tick, n);
+    for (int k = 0; k < n; k++) {
+        if (released[k].id == id) {
+            return k;
+        }
+    }
+    return -1;
+}
+
+ZTEST(stbs_table, test_precedence_order)
+{
+    // the consumer would go first on its priority
+    STBS_Init(TEST_TICK_US, TEST_MAX_TASKS);
+    int consumer = add_task(1, 1, 1000, "consumer");
+    add_task(2, 2, 1000, "b");
+    int producer = add_task(1, 3, 1000, "producer");
+    zassert_ok(STBS_AddPrecedence(TASK_ID(producer), TASK_ID(consumer), 0));
+
+    zassert_ok(STBS_BuildTable());
+    for (int tick = 0; tick < STBS_GetMacroCycle(); tick++) {
+        int p = tick_position(tick, TASK_ID(producer));
+        int c = tick_position(tick, TASK_ID(consumer));
+
+        zassert_true(p >= 0 && c >= 0, "tick %d: a task is not released", tick);
+        zassert_true(p < c, "tick %d: consumer at %d before its producer at %d", tick, c, p);
+    }
+    zassert_equal(STBS_GetPrecedenceLag(0), 0);
+    zassert_equal(STBS_GetPrecedenceLag(1), -EINVAL);
+    STBS_destroy();
+}
+
+ZTEST(stbs_table, test_precedence_lag)
+{
+    // the two jobs do not fit one tick: the consumer reads the output one tick later
+    for (int max_lag = 0; max_lag < 2; max_lag++) {
+        STBS_Init(TEST_TICK_US, TEST_MAX_TASKS);
+        int consumer = add_task(2, 1, 6000, "consumer");
+        int producer = add_task(2, 1, 6000, "producer");
+        zassert_ok(STBS_AddPrecedence(TASK_ID(producer), TASK_ID(consumer), max_lag));
+
+        zassert_ok(STBS_Check(NULL), "the lag is only known once the table is built");
+        if (max_lag == 0) {
+            zassert_equal(STBS_BuildTable(), -ENOSPC, "lag bound not enforced");
+            zassert_equal(STBS_GetPrecedenceLag(0), -ENODATA, "the table was not freed");
+        } else {
+            zassert_ok(STBS_BuildTable());
+            zassert_equal(STBS_GetPrecedenceLag(0), 1);
+            zassert_equal(tick_position(0, TASK_ID(producer)), 0);
+            zassert_equal(tick_position(1, TASK_ID(consumer)), 0);
+        }
+    }
+    STBS_destroy();
+}
+
+ZTEST(stbs_table, test_precedence_cycle)
+{
+    STBS_check_report report;
+
+    STBS_Init(TEST_TICK_US, TEST_MAX_TASKS);
+    int a = add_task(1, 1, 1000, "a");
+    int b = add_task(1, 1, 1000, "b");
+    int c = add_task(1, 1, 1000, "c");
+    int d = add_task(1, 1, 1000, "d");
+    zassert_ok(STBS_AddPrecedence(TASK_ID(d), TASK_ID(a), 0));
+    zassert_ok(STBS_AddPrecedence(TASK_ID(a), TASK_ID(b), 0));
+    zassert_ok(STBS_AddPrecedence(TASK_ID(b), TASK_ID(c), 0));
+    zassert_ok(STBS_BuildTable(), "no cycle yet");
+
+    zassert_ok(STBS_AddPrecedence(TASK_ID(c), TASK_ID(a), 0));
+    zassert_equal(STBS_Check(&report), -EINVAL);
+    zassert_true(report.failed_task == a || report.failed_task == b || report.failed_task == c,
+                 "task %d is not in the cycle", report.failed_task);
+    zassert_equal(STBS_BuildTable(), -EINVAL);
+    zassert_equal(STBS_GetPrecedenceLag(0), -ENODATA);
+    STBS_destroy();
+}
+
+ZTEST(stbs_table, test_chain_latency)
+{
+    k_tid_t chain[3];
+
+    // three tasks every tick, back to back from the start of the tick: 1 + 2 + 3 ms
+    STBS_Init(TEST_TICK_US, TEST_MAX_TASKS);
+    for (int i = 0; i < 3; i++) {
+        chain[i] = TASK_ID(add_task(1, 3 - i, (i + 1) * 1000, "chain"));
+    }
+    zassert_ok(STBS_AddPrecedence(chain[0], chain[1], 0));
+    zassert_ok(STBS_AddPrecedence(chain[1], chain[2], 0));
+    zassert_equal(STBS_GetChainLatency(chain, 3), -ENODATA, "no table yet");
+    zassert_ok(STBS_BuildTable());
+    zassert_equal(STBS_GetChainLatency(chain, 3), 6000);
+    zassert_equal(STBS_GetChainLatency(chain, 2), 3000);
+    zassert_equal(STBS_GetChainLatency(chain, 0), -EINVAL);
+
+    // the consumer runs a tick after its producer: from the start of tick 0 to 6 ms into tick 1
+    STBS_Init(TEST_TICK_US, TEST_MAX_TASKS);
+    chain[1] = TASK_ID(add_task(2, 1, 6000, "consumer"));
+    chain[0] = TASK_ID(add_task(2, 1, 6000, "producer"));
+    zassert_ok(STBS_AddPrecedence(chain[0], chain[1], 1));
+    zassert_ok(STBS_BuildTable());
+    zassert_equal(STBS_GetChainLatency(chain, 2), TEST_TICK_US + 6000);
+    STBS_destroy();
+}
+
+ZTEST(stbs_table, test_jitter_bound)
+{
+    STBS_Init(TEST_TICK_US, TEST_MAX_TASKS);
+    add_task(2, 1, 4000, "a");
+    int j = add_task(1, 2, 1000, "j");
+    zassert_equal(STBS_SetMaxJitter(TASK_ID(TEST_MAX_TASKS), 0), -EINVAL, "task not registered");
+    zassert_equal(STBS_SetMaxJitter(TASK_ID(j), -2), -EINVAL);
+    zassert_equal(STBS_GetJitter(TASK_ID(j)), -ENODATA, "no table yet");
+    zassert_equal(STBS_GetJitter(TASK_ID(TEST_MAX_TASKS)), -EINVAL);
+
+    // on its priority, j starts after a in tick 0 and at the start of tick 1
+    zassert_ok(STBS_BuildTable());
+    zassert_equal(STBS_GetJitter(TASK_ID(j)), 4000);
+    zassert_equal(tick_position(0, TASK_ID(j)), 1);
+
+    // bounded, it goes first in every tick
+    zassert_ok(STBS_SetMaxJitter(TASK_ID(j), 0));
+    zassert_ok(STBS_BuildTable());
+    zassert_equal(STBS_GetJitter(TASK_ID(j)), 0);
+    for (int tick = 0; tick < STBS_GetMacroCycle(); tick++) {
+        zassert_equal(tick_position(tick, TASK_ID(j)), 0, "tick %d: bounded task not first", tick);
+    }
+
+    // removing the bound restores the order of the priorities
+    zassert_ok(STBS_SetMaxJitter(TASK_ID(j), -1));
+    zassert_ok(STBS_BuildTable());
+    zassert_equal(STBS_GetJitter(TASK_ID(j)), 4000);
+    STBS_destroy();
+}
+
+ZTEST(stbs_table, test_jitter_impossible)
+{
+    STBS_Init(TEST_TICK_US, TEST_MAX_TASKS);
+    int a = add_task(2, 1, 4000, "a");
+    int j = add_task(1, 2, 1000, "j");
+
+    // the tighter bound of a puts it first, so j still starts 4 ms apart in ticks 0 and 1
+    zassert_ok(STBS_SetMaxJitter(TASK_ID(a), 0));
+    zassert_ok(STBS_SetMaxJitter(TASK_ID(j), 100));
+    zassert_ok(STBS_Check(NULL), "the jitter is only known once the table is built");
+    zassert_equal(STBS_BuildTable(), -ENOSPC);
+    zassert_equal(STBS_GetJitter(TASK_ID(j)), -ENODATA, "the table was not freed");
+
+    // a bound both can meet
+    zassert_ok(STBS_SetMaxJitter(TASK_ID(j), 4000));
+    zassert_ok(STBS_BuildTable());
+    zassert_equal(STBS_GetJitter(TASK_ID(a)), 0);
+    zassert_equal(STBS_GetJitter(TASK_ID(j)), 4000);
+    STBS_destroy();
+}
+
+static void *stbs_table_setup(void) {
+    // the figures are for the execution times alone, not for the overheads of the board
+    static const STBS_overhead no_overhead = {0};
+
+    zassert_ok(STBS_SetOverhead(&no_overhead));
+    return NULL;
+}
+
+ZTEST_SUITE(stbs_table, NULL, stbs_table_setup, NULL, NULL, NULL);